@@ -0,0 +1,32 @@
+#ifndef BLOCK_KERNELS_HPP
+#define BLOCK_KERNELS_HPP
+
+#include <cstddef>
+
+namespace cvfork {
+
+/*
+ * Kernels for the blocks of the calibration normal equations built from transposed Jacobians
+ * (one row per parameter, rows of length len). Block sizes are compile-time constants inside,
+ * the results are written straight into the destination blocks without temporary matrices.
+ * Steps are given in elements, the number of rows is limited by CV_CALIB_NINTRINSIC.
+ * Single precision inputs are accumulated in float, results are always stored as double.
+ */
+
+// C = A*A^t, A has m rows
+void multiplyTransposedSelf( const double* A, size_t astep, int m, int len, double* C, size_t cstep );
+void multiplyTransposedSelf( const float* A, size_t astep, int m, int len, double* C, size_t cstep );
+
+// C = A*B^t, A has m rows, B has 6 rows
+void multiplyTransposedExtrinsic( const double* A, size_t astep, int m, const double* B, size_t bstep,
+                                  int len, double* C, size_t cstep );
+void multiplyTransposedExtrinsic( const float* A, size_t astep, int m, const float* B, size_t bstep,
+                                  int len, double* C, size_t cstep );
+
+// c = A*b, A has m rows
+void multiplyVector( const double* A, size_t astep, int m, const double* b, int len, double* c, size_t cstep );
+void multiplyVector( const float* A, size_t astep, int m, const float* b, int len, double* c, size_t cstep );
+
+}
+
+#endif
@@ -1,8 +1,13 @@
 #ifndef CALIB_COMMON_HPP
 #define CALIB_COMMON_HPP
 
+#include "coverageIndex.hpp"
+#include "observationStore.hpp"
+#include "poseIndex.hpp"
+
 #include <memory>
 #include <opencv2/core.hpp>
+#include <string>
 #include <vector>
 
 namespace calib
@@ -26,6 +31,8 @@ namespace calib
                               "v - switch visualisation";
 
     static const double sigmaMult = 1.96;
+    // frames with the board rotated further (degrees) are rejected, the pose bins cover the rest
+    static const double maxBoardAngle = 40.;
 
     struct calibrationData
     {
@@ -33,16 +40,17 @@ namespace calib
         cv::Mat distCoeffs;
         cv::Mat stdDeviations;
         cv::Mat perViewErrors;
+        cv::Mat perViewLooErrors;
         std::vector<cv::Mat> rvecs;
         std::vector<cv::Mat> tvecs;
         double totalAvgErr;
         cv::Size imageSize = cv::Size(IMAGE_MAX_WIDTH, IMAGE_MAX_HEIGHT);
 
-        std::vector<std::vector<cv::Point2f>> imagePoints;
-        std::vector< std::vector<cv::Point3f>> objectPoints;
-
-        std::vector<cv::Mat> allCharucoCorners;
-        std::vector<cv::Mat> allCharucoIds;
+        observationStore observations;
+        // grid histogram of all the captured points, follows the views above
+        coverageIndex coverage;
+        // board pose bins of the views
+        poseIndex poses;
 
         cv::Mat undistMap1, undistMap2;
     };
@@ -79,13 +87,32 @@ namespace calib
         cv::Size cameraResolution = cv::Size(IMAGE_MAX_WIDTH, IMAGE_MAX_HEIGHT);
         int maxFramesNum = 30;
         int minFramesNum = 10;
+        // frames kept before the best maxFramesNum of them are selected, 0 to filter after every calibration
+        int candidatePoolSize = 0;
+        // views per pose bin, frames falling into full bins are rejected, 0 for no limit
+        int poseBinCapacity = 0;
     };
 
     struct internalParameters
     {
         double solverEps = 1e-7;
         int solverMaxIters = 30;
+        double solverTimeBudget = 0; // seconds, 0 for no limit
         bool fastSolving = false;
+        bool schurSolving = false;
+        bool parallelSolving = false;
+        bool incrementalSolving = false;
+        int incrementalMaxIters = 5;
+        bool reuseFactorization = false;
+        bool doglegSolving = false;
+        bool mixedPrecision = false;
+        bool broydenUpdates = false;
+        bool divisionModelInit = false;
+        bool pcgSolving = false;
+        // once there are enough frames, calibrate the candidate models in parallel and keep the best by BIC
+        bool speculativeTuning = false;
+        // default, opencv, lapack, builtin or auto (the fastest one on the startup benchmark)
+        std::string linalgBackend = "default";
         double filterAlpha = 0.1;
     };
 
@@ -33,6 +33,8 @@ namespace calib {
         bool getRMSState() const;
         bool getPointsCoverageState() const;
         int getNewFlags() const;
+        // flags of a model chosen outside of the controller
+        void setNewFlags(int flags);
     };
 
     class calibDataController
@@ -43,13 +45,13 @@ namespace calib {
         std::string mParamsFileName;
         unsigned mMaxFramesNum;
         double mAlpha;
-
-        double estimateGridSubsetQuality(size_t excludedIndex);
     public:
         calibDataController(Sptr<calibrationData> data, int maxFrames, double convParameter);
         calibDataController();
 
         void filterFrames();
+        // keeps the best maxFrames of the captured frames, chosen greedily in one pass
+        void selectFrames();
         void setParametersFileName(const std::string& name);
         void deleteLastFrame();
         void rememberCurrentParameters();
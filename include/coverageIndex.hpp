@@ -0,0 +1,46 @@
+#ifndef COVERAGE_INDEX_HPP
+#define COVERAGE_INDEX_HPP
+
+#include "observationStore.hpp"
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+namespace calib {
+
+// Histogram of the captured points over a grid of image cells, kept up to date
+// as frames are added and removed. Every frame keeps its own cell counts,
+// so the quality of the set without one frame costs O(cells). Frames follow the views
+// of the observation store
+class coverageIndex
+{
+protected:
+    cv::Size mImageSize;
+    std::vector<std::vector<int>> mFrameCells;
+    std::vector<int> mTotalCells;
+
+    int cellIndex(const cv::Point2f& point) const;
+    void countFrame(const cv::Mat& points, std::vector<int>& cells) const;
+    double quality(const std::vector<int>& cells, const std::vector<int>* excluded) const;
+public:
+    static const int gridSize = 10;
+
+    coverageIndex();
+
+    // rebins all the frames from their views if the size has changed
+    void setImageSize(cv::Size size, const observationStore& observations);
+    // CV_32FC2 points of the frame
+    void addFrame(const cv::Mat& points);
+    void removeFrame(size_t index);
+    void clear();
+    size_t framesCount() const;
+    const std::vector<int>& frameCells(size_t index) const;
+
+    // mean number of points per cell divided by its standard deviation
+    double quality() const;
+    double qualityWithout(size_t index) const;
+};
+
+}
+
+#endif
@@ -4,14 +4,51 @@
 #include <opencv2/core.hpp>
 #include <opencv2/aruco/charuco.hpp>
 #include <opencv2/calib3d.hpp>
+#include "linalg.hpp"
 
 namespace cvfork
 {
 using namespace cv;
 
 #define CV_CALIB_NINTRINSIC 18
-#define CALIB_USE_QR (1 << 18)
+// the same bit as cv::CALIB_USE_QR, 1 << 18 is taken by CALIB_TILTED_MODEL
+#define CALIB_USE_QR (1 << 20)
+// Bits 0-22 are OpenCV 3.x calibration flags (cv::CALIB_USE_EXTRINSIC_GUESS is the last one, 1 << 22),
+// bits 23-31 are reserved for the fork flags below. OpenCV doesn't reserve them, so an update that
+// defines a CALIB_* flag there must be checked against this list, and the fork flags moved to their
+// own options argument. CALIB_USE_PCG takes the sign bit: the flags are only tested bitwise,
+// never compared or shifted right
+#define CALIB_USE_SCHUR (1 << 23)
+#define CALIB_USE_PARALLEL (1 << 24)
+#define CALIB_FORK_USE_EXTRINSIC_GUESS (1 << 25)
+// dense solver only, it has no effect together with CALIB_USE_SCHUR, CALIB_USE_PCG or CALIB_USE_DOGLEG
+#define CALIB_REUSE_FACTORIZATION (1 << 26)
+#define CALIB_USE_DOGLEG (1 << 27)
+// projection and normal equations accumulation in float until convergence, then double refinement
+#define CALIB_USE_MIXED_PRECISION (1 << 28)
+// Jacobians between the periodic analytic ones are Broyden updates of the previous one
+#define CALIB_USE_BROYDEN (1 << 29)
+// closed-form initial focal length and radial distortion from the division model
+// instead of the distortion-free guess (planar rigs without CALIB_USE_INTRINSIC_GUESS)
+#define CALIB_INIT_DIVISION_MODEL (1 << 30)
+// block LM steps are solved inexactly by preconditioned conjugate gradients
+#define CALIB_USE_PCG ((int)(1u << 31))
 
+// statistics of the last optimization run
+struct SolverStats
+{
+    int iterations;
+    int jacobianEvals;
+    int fullJacobianEvals; // analytic ones, the rest are Broyden updates
+    int errorEvals;
+    int linearIterations;  // conjugate gradient iterations of all steps, 0 for direct solvers
+    DecompCounters decompositions; // direct solves of the steps by each decomposition
+    bool converged;        // false if the optimization was stopped by the time budget
+    SolverStats() : iterations(0), jacobianEvals(0), fullJacobianEvals(0), errorEvals(0), linearIterations(0),
+        converged(true) {}
+};
+
+// stdDeviations: intrinsic deviations followed by the extrinsic ones of every view
 double calibrateCamera(InputArrayOfArrays objectPoints,
                                      InputArrayOfArrays imagePoints, Size imageSize,
                                      InputOutputArray cameraMatrix, InputOutputArray distCoeffs,
@@ -19,6 +56,36 @@ double calibrateCamera(InputArrayOfArrays objectPoints,
                                      OutputArray perViewErrors, int flags = 0, TermCriteria criteria = TermCriteria(
                                         TermCriteria::COUNT + TermCriteria::EPS, 30, DBL_EPSILON) );
 
+// calibrateCamera with the fork outputs. Extrinsic deviations are computed only if they are requested.
+// perViewLooErrors: leave-one-out RMS error of every view, i.e. its error under the intrinsics
+// estimated without it (linearized at the solution), which shows how much a view pulls the fit.
+// timeBudget: seconds the calibration may take, 0 for no limit. When it runs out, the last accepted
+// parameters are returned and stats->converged is cleared; the calibration may be continued
+// from them with CALIB_USE_INTRINSIC_GUESS and CALIB_FORK_USE_EXTRINSIC_GUESS
+double calibrateCameraExtended(InputArrayOfArrays objectPoints,
+                                     InputArrayOfArrays imagePoints, Size imageSize,
+                                     InputOutputArray cameraMatrix, InputOutputArray distCoeffs,
+                                     OutputArrayOfArrays rvecs, OutputArrayOfArrays tvecs,
+                                     OutputArray stdDeviationsIntrinsics, OutputArray stdDeviationsExtrinsics,
+                                     OutputArray perViewErrors, OutputArray perViewLooErrors,
+                                     int flags = 0, TermCriteria criteria = TermCriteria(
+                                        TermCriteria::COUNT + TermCriteria::EPS, 30, DBL_EPSILON),
+                                     SolverStats* stats = 0, double timeBudget = 0 );
+
+// calibration from views of one board without per-view copies: boardPoints is the board model (Point3f),
+// the views are consecutive spans of viewSizes[i] image points (Point2f) and pointIds[j] is the model
+// point of the image point j
+double calibrateCameraIndexed(InputArray boardPoints, InputArray pointIds, InputArray imagePoints,
+                                     InputArray viewSizes, Size imageSize,
+                                     InputOutputArray cameraMatrix, InputOutputArray distCoeffs,
+                                     OutputArrayOfArrays rvecs, OutputArrayOfArrays tvecs,
+                                     OutputArray stdDeviationsIntrinsics, OutputArray stdDeviationsExtrinsics,
+                                     OutputArray perViewErrors, OutputArray perViewLooErrors,
+                                     int flags = 0, TermCriteria criteria = TermCriteria(
+                                        TermCriteria::COUNT + TermCriteria::EPS, 30, DBL_EPSILON),
+                                     SolverStats* stats = 0, double timeBudget = 0 );
+
+// point_ids: if set, object_points is the board model and the image point j observes its point point_ids[j]
 double cvCalibrateCamera2( const CvMat* object_points,
                                 const CvMat* image_points,
                                 const CvMat* point_counts,
@@ -29,9 +96,13 @@ double cvCalibrateCamera2( const CvMat* object_points,
                                 CvMat* translation_vectors CV_DEFAULT(NULL),
                                 CvMat* stdDeviations_vector CV_DEFAULT(NULL),
                                 CvMat* perViewErrors_vector CV_DEFAULT(NULL),
+                                CvMat* perViewLooErrors_vector CV_DEFAULT(NULL),
                                 int flags CV_DEFAULT(0),
                                 CvTermCriteria term_crit CV_DEFAULT(cvTermCriteria(
-                                    CV_TERMCRIT_ITER+CV_TERMCRIT_EPS,30,DBL_EPSILON)) );
+                                    CV_TERMCRIT_ITER+CV_TERMCRIT_EPS,30,DBL_EPSILON)),
+                                SolverStats* stats CV_DEFAULT(NULL),
+                                double timeBudget CV_DEFAULT(0),
+                                const CvMat* point_ids CV_DEFAULT(NULL) );
 
 double calibrateCameraCharuco(InputArrayOfArrays _charucoCorners, InputArrayOfArrays _charucoIds,
                               Ptr<aruco::CharucoBoard> &_board, Size imageSize,
@@ -40,15 +111,74 @@ double calibrateCameraCharuco(InputArrayOfArrays _charucoCorners, InputArrayOfAr
                               int flags = 0, TermCriteria criteria = TermCriteria(
                                     TermCriteria::COUNT + TermCriteria::EPS, 30, DBL_EPSILON) );
 
+// calibrateCameraCharuco with the outputs of calibrateCameraExtended
+double calibrateCameraCharucoExtended(InputArrayOfArrays _charucoCorners, InputArrayOfArrays _charucoIds,
+                              Ptr<aruco::CharucoBoard> &_board, Size imageSize,
+                              InputOutputArray _cameraMatrix, InputOutputArray _distCoeffs,
+                              OutputArrayOfArrays _rvecs, OutputArrayOfArrays _tvecs, OutputArray _stdDeviationsIntrinsics,
+                              OutputArray _stdDeviationsExtrinsics, OutputArray _perViewErrors, OutputArray _perViewLooErrors,
+                              int flags = 0, TermCriteria criteria = TermCriteria(
+                                    TermCriteria::COUNT + TermCriteria::EPS, 30, DBL_EPSILON),
+                              SolverStats* stats = 0, double timeBudget = 0 );
+
 class CvLevMarqFork : public CvLevMarq
 {
 public:
     CvLevMarqFork( int nparams, int nerrs, CvTermCriteria criteria=
               cvTermCriteria(CV_TERMCRIT_EPS+CV_TERMCRIT_ITER,30,DBL_EPSILON),
               bool completeSymmFlag=false );
-    bool updateAlt( const CvMat*& _param, CvMat*& _JtJ, CvMat*& _JtErr, double*& _errNorm );
-    void step();
-    ~CvLevMarqFork();
+    virtual bool updateAlt( const CvMat*& _param, CvMat*& _JtJ, CvMat*& _JtErr, double*& _errNorm );
+    virtual void step();
+    virtual ~CvLevMarqFork();
+
+    // blocks of the arrow-shaped calibration normal equations (see HZ: (A6.14)),
+    // parameters are laid out as [intrinsics, extrinsics of view 0, extrinsics of view 1, ...].
+    // Intrinsic rows and columns are compacted: only the parameters listed in intrinsicIndex()
+    // are stored, fixed ones never get into the normal equations.
+    virtual Mat intrinsicBlock();
+    virtual Mat viewBlock( int view );
+    virtual Mat couplingBlock( int view );
+    Mat intrinsicErr();
+    Mat viewErr( int view );
+    const std::vector<int>& intrinsicIndex() const;
+
+    // standard deviations from the normal equations of the last evaluated Jacobian.
+    // Intrinsic covariance is the inverse of the reduced camera system, so the full matrix is
+    // never inverted; extrinsics (NINTRINSIC + 6*view + k) are filled only if withExtrinsics is set
+    void calcStdDevs( double sigma2, double* stdDevs, bool withExtrinsics );
+
+    // decompositions used by the steps so far, see SymmetricSolver
+    DecompCounters decompositionCounters() const;
+
+    // factor the normal matrix once per Jacobian evaluation and reuse the factor for the lambda retries
+    // (dense solver only, solveMethod is used only if the damped matrix isn't positive definite)
+    bool reuseFactorization;
+
+protected:
+    CvLevMarqFork();
+    // CvLevMarq::init without the normal equations, which every solver lays out on its own:
+    // parameters, mask, termination criteria and the initial solver state
+    void initState( int nparams, CvTermCriteria criteria, bool completeSymmFlag );
+    virtual void clearNormalEquations();
+    // called once the mask is set, before the first Jacobian evaluation
+    virtual void initLayout();
+    void buildIntrinsicIndex();
+    // Cholesky factor (in JtJN) of the Jacobi-scaled normal matrix D*JtJ*D damped by lambda,
+    // false if it isn't positive definite
+    bool factorize( double lambda );
+    // solves the step of a larger lambda by CG preconditioned with the factor, each iteration costs
+    // O(n^2); false if CG doesn't converge before its cost approaches a new factorization
+    bool solveFactorized( double lambda, Mat& delta );
+
+    std::vector<int> intrinsicIdx;
+    int viewsOffset;
+    // keeps LAPACK workspace between the steps, the system size is fixed during calibration
+    SymmetricSolver linearSolver;
+    bool factorized;
+    double factorLambda;
+    // factorizations and their reuses done by the steps themselves, bypassing linearSolver
+    DecompCounters factorCounters;
+    Mat jacobiScale, scaledJtJ, scaledErr, cgBuf;
 };
 }
 
@@ -0,0 +1,26 @@
+#ifndef DISTORTION_INIT_HPP
+#define DISTORTION_INIT_HPP
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+namespace cvfork {
+
+/*
+ * Closed-form initialization of planar calibration for lenses with strong radial distortion.
+ * The image is described by the one-parameter division model x_u = c + (x_d - c)/(1 + lambda*r_d^2)
+ * around the principal point of A. Per view, the first two rows of the homography follow from
+ * the radial alignment constraint, which doesn't depend on lambda, then the third rows and
+ * the shared lambda come from one linear system. Focal length is initialized on the undistorted
+ * points and lambda is converted to the closest k1 (and k2 unless flags contain CALIB_FIX_K2).
+ * objPoints are 1 x total CV_64FC3 with z = 0, imgPoints are 1 x total CV_64FC2, view i owns
+ * points [viewOffsets[i], viewOffsets[i + 1]). A must hold the distortion-free initial guess;
+ * returns false and leaves A and k untouched if the estimate is degenerate.
+ */
+bool initIntrinsicParamsDivisionModel( const cv::Mat& objPoints, const cv::Mat& imgPoints,
+                                       const std::vector<int>& viewOffsets, cv::Size imageSize,
+                                       double aspectRatio, int flags, cv::Matx33d& A, double* k );
+
+}
+
+#endif
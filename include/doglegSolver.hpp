@@ -0,0 +1,38 @@
+#ifndef DOGLEG_SOLVER_HPP
+#define DOGLEG_SOLVER_HPP
+
+#include "cvCalibrationFork.hpp"
+
+namespace cvfork
+{
+
+/*
+ * Powell's dogleg trust-region solver with the same reverse-communication interface
+ * as CvLevMarqFork. The Gauss-Newton and steepest descent steps are computed once per
+ * Jacobian evaluation, a rejected step only shrinks the trust region and moves along
+ * the same dogleg path, so it costs one error evaluation and no linear solve.
+ * The trust region is measured in parameters scaled by sqrt(diag(JtJ)).
+ */
+class CvDoglegFork : public CvLevMarqFork
+{
+public:
+    CvDoglegFork( int nparams, CvTermCriteria criteria=
+              cvTermCriteria(CV_TERMCRIT_EPS+CV_TERMCRIT_ITER,30,DBL_EPSILON) );
+    virtual bool updateAlt( const CvMat*& _param, CvMat*& _JtJ, CvMat*& _JtErr, double*& _errNorm );
+    virtual void step();
+    virtual ~CvDoglegFork();
+
+protected:
+    // Gauss-Newton and Cauchy points of the current Jacobian in scaled parameters
+    void computeSteps();
+
+    double radius;
+    double predictedReduction;
+    double stepNorm;
+    double paramNorm;
+    Mat scaledJtJ, scaledErr, gaussNewtonStep, cauchyStep;
+};
+
+}
+
+#endif
@@ -30,12 +30,14 @@ protected:
     std::vector<cv::Point2f> mCurrentImagePoints;
     cv::Mat mCurrentCharucoCorners;
     cv::Mat mCurrentCharucoIds;
+    int mCurrentPoseBin;
 
     cv::Ptr<cv::SimpleBlobDetector> mBlobDetectorPtr;
     cv::Ptr<cv::aruco::Dictionary> mArucoDictionary;
     cv::Ptr<cv::aruco::CharucoBoard> mCharucoBoard;
 
     int mNeededFramesNum;
+    int mCandidatePoolSize;
     unsigned mDelayBetweenCaptures;
     int mCapuredFrames;
     float mMaxTemplateOffset;
@@ -46,6 +48,8 @@ protected:
     bool detectAndParseChAruco(const cv::Mat& frame);
     bool detectAndParseACircles(const cv::Mat& frame);
     bool detectAndParseDualACircles(const cv::Mat& frame);
+    void initBoardModel();
+    // saves the current detection with the pose bin found by checkLastFrame()
     void saveFrameData();
     void showCaptureMessage(const cv::Mat &frame, const std::string& message);
     bool checkLastFrame();
@@ -0,0 +1,40 @@
+#ifndef LEV_MARQ_SCHUR_HPP
+#define LEV_MARQ_SCHUR_HPP
+
+#include "cvCalibrationFork.hpp"
+
+namespace cvfork
+{
+
+/*
+ * Levenberg-Marquardt solver for the calibration problem which keeps only the
+ * non-zero blocks of the normal matrix: the intrinsic block, one 6x6 block per view
+ * and the intrinsic/extrinsic couplings. Extrinsics are eliminated with the Schur
+ * complement, so a step costs O(nviews) and no (18 + 6*nviews)^2 matrix is allocated.
+ */
+class CvLevMarqSchur : public CvLevMarqFork
+{
+public:
+    CvLevMarqSchur( int nviews, CvTermCriteria criteria=
+              cvTermCriteria(CV_TERMCRIT_EPS+CV_TERMCRIT_ITER,30,DBL_EPSILON) );
+    virtual void step();
+    virtual ~CvLevMarqSchur();
+
+    virtual Mat intrinsicBlock();
+    virtual Mat viewBlock( int view );
+    virtual Mat couplingBlock( int view );
+
+protected:
+    virtual void clearNormalEquations();
+    virtual void initLayout();
+
+    int nviews;
+    Mat JtJii;   // NINTRINSIC x NINTRINSIC, variable intrinsics are in the top-left corner
+    Mat JtJie;   // nviews blocks of NINTRINSIC x 6, stacked vertically, same row layout
+    Mat JtJee;   // nviews blocks of 6 x 6, stacked vertically
+    Mat viewInv; // inverted damped extrinsic blocks of the last step
+};
+
+}
+
+#endif
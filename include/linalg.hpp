@@ -2,12 +2,88 @@
 #define LINALG_HPP
 
 #include <opencv2/core.hpp>
+#include <string>
+#include <vector>
 
 namespace cvfork {
 
 double invert( cv::InputArray _src, cv::OutputArray _dst, int method );
 bool solve(cv::InputArray _src, cv::InputArray _src2arg, cv::OutputArray _dst, int method );
 
+// solves A*X = B for a symmetric positive definite m x m matrix A (only the lower triangle is read),
+// A is overwritten by its Cholesky factor and B by the solution, returns false if A is not positive definite
+bool choleskySolve( double* A, size_t astep, int m, double* B, size_t bstep, int n );
+// solves A*X = B by the factor choleskySolve() has left in L
+void choleskyBackSubst( const double* L, size_t lstep, int m, double* B, size_t bstep, int n );
+
+// inverts a (scaled on diagonal) symmetric 6x6 extrinsic block, degenerate views fall back to pseudo-inverse
+void invertViewBlock( const double* src, double diagScale, cv::Matx66d& dst );
+
+// linear algebra backends of SymmetricSolver
+enum
+{
+    LINALG_OPENCV = 0,  // cv::solve
+    LINALG_LAPACK = 1,  // LAPACK, only if built with USE_LAPACK
+    LINALG_BUILTIN = 2, // blocked Cholesky, other decompositions are done by OpenCV
+    LINALG_BACKEND_COUNT
+};
+
+// one backend instance serves one solver and may keep workspace between the calls. Only the LAPACK
+// backend has any: its workspace is queried in prepare(), the other backends allocate in every call
+class LinalgBackend
+{
+public:
+    virtual ~LinalgBackend() {}
+    // called when the system size or the method changes
+    virtual void prepare( int n, int method ) = 0;
+    // solves A*x = b, A is destroyed. With checkCondition Cholesky and QR also fail
+    // when the pivots of the factor put the condition number above 1e12
+    virtual bool solve( cv::Mat& A, const cv::Mat& b, cv::Mat& x, int method, bool checkCondition ) = 0;
+};
+
+bool isLinalgBackendAvailable( int backend );
+const char* getLinalgBackendName( int backend );
+// -1 for unknown names
+int getLinalgBackendByName( const std::string& name );
+// the backend is taken by the solvers created after the call. The default one is LAPACK if it's
+// available and the built-in one otherwise
+void setLinalgBackend( int backend );
+int getLinalgBackend();
+cv::Ptr<LinalgBackend> createLinalgBackend( int backend );
+// times the solution of a random n x n normal system by every available backend,
+// makes the fastest one current and returns it
+int selectFastestLinalgBackend( int n, int method );
+
+// how many linear systems were solved by each decomposition
+struct DecompCounters
+{
+    int cholesky, qr, svd, lu;
+    int reused; // solves with an earlier factor instead of a new decomposition
+    DecompCounters() : cholesky(0), qr(0), svd(0), lu(0), reused(0) {}
+};
+
+/*
+ * Solver for repeated symmetric systems A*x = b of the same size (the damped normal equations)
+ * on the backend which was current when it was created. Since A is symmetric it's passed to the
+ * backend as is, without transposition, and it's factored in place, so its contents are destroyed.
+ * DECOMP_CHOLESKY is adaptive: the Jacobi-scaled system is factored by Cholesky, and only
+ * if it breaks down or its pivots show the condition number above 1e12 the step is redone
+ * with QR, and then with SVD. Other methods are used as is.
+ */
+class SymmetricSolver
+{
+public:
+    SymmetricSolver();
+    bool solve( cv::Mat& A, const cv::Mat& b, cv::Mat& x, int method );
+    const DecompCounters& counters() const;
+
+protected:
+    int n, method;
+    cv::Ptr<LinalgBackend> backend;
+    cv::Mat scale, scaledRhs, scaledCopy;
+    DecompCounters decompCounters;
+};
+
 }
 
 #endif
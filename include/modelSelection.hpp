@@ -0,0 +1,49 @@
+#ifndef MODEL_SELECTION_HPP
+#define MODEL_SELECTION_HPP
+
+#include "calibCommon.hpp"
+#include "cvCalibrationFork.hpp"
+
+#include <string>
+#include <vector>
+
+namespace calib {
+
+    // flags the greedy tuning of calibController sets one by one
+    static const int tuningFlags = cv::CALIB_FIX_ASPECT_RATIO | cv::CALIB_ZERO_TANGENT_DIST |
+            cv::CALIB_FIX_K1 | cv::CALIB_FIX_K2 | cv::CALIB_FIX_K3;
+
+    struct calibrationCandidate
+    {
+        std::string name;
+        int flags;
+        double totalAvgErr = 0;
+        double criterion = 0;
+        cv::Mat cameraMatrix;
+        cv::Mat distCoeffs;
+        cv::Mat stdDeviations;
+        cv::Mat perViewErrors;
+        cv::Mat perViewLooErrors;
+        std::vector<cv::Mat> rvecs;
+        std::vector<cv::Mat> tvecs;
+        cvfork::SolverStats stats;
+
+        calibrationCandidate(const std::string& _name, int _flags) : name(_name), flags(_flags) {}
+    };
+
+    // full model, fixed aspect ratio, zero tangential distortion, fixed k3, all of them,
+    // rational and thin prism models; tuning flags of baseFlags are cleared
+    std::vector<calibrationCandidate> candidateModels(int baseFlags);
+
+    // number of the intrinsic parameters estimated under the flags
+    int countIntrinsicParams(int flags);
+
+    // calibrates the candidates in parallel, the current parameters of data are the initial guess if
+    // the flags ask for it. Returns the candidate with the lowest BIC, the ones stopped by the time
+    // budget are chosen only if no candidate converged. timeBudget is shared by all the candidates
+    size_t calibrateCandidates(const calibrationData& data, cv::TermCriteria criteria, double timeBudget,
+                               std::vector<calibrationCandidate>& candidates);
+
+}
+
+#endif
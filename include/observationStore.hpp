@@ -0,0 +1,52 @@
+#ifndef OBSERVATION_STORE_HPP
+#define OBSERVATION_STORE_HPP
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+namespace calib {
+
+// Captured views of one calibration board. The board model is kept once, a view is a span of
+// the point ids and image points shared by all the views, so the solver, the coverage index
+// and the drawing code read the observations in place
+class observationStore
+{
+protected:
+    std::vector<cv::Point3f> mBoardPoints;
+    std::vector<int> mPointIds;
+    std::vector<cv::Point2f> mImagePoints;
+    std::vector<int> mViewOffsets;
+    std::vector<int> mViewSizes;
+
+    void appendView(size_t pointsNum);
+public:
+    observationStore();
+
+    void setBoardModel(const std::vector<cv::Point3f>& boardPoints);
+    const std::vector<cv::Point3f>& boardModel() const;
+
+    // all the board points in the model order
+    void addView(const std::vector<cv::Point2f>& imagePoints);
+    // points are CV_32FC2, ids of the model points are CV_32S
+    void addView(const cv::Mat& imagePoints, const cv::Mat& pointIds);
+    void removeView(size_t index);
+    // indices are sorted, the order of the views is kept
+    void keepViews(const std::vector<size_t>& indices);
+    void clear();
+
+    size_t viewsCount() const;
+    size_t pointsCount() const;
+
+    // 1xn headers of the shared arrays, CV_32FC2 points and CV_32S ids
+    cv::Mat viewPoints(size_t index) const;
+    cv::Mat viewIds(size_t index) const;
+    cv::Mat allPoints() const;
+    cv::Mat allIds() const;
+    // CV_32S numbers of points of every view
+    cv::Mat viewSizes() const;
+    void viewObjectPoints(size_t index, std::vector<cv::Point3f>& objectPoints) const;
+};
+
+}
+
+#endif
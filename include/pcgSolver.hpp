@@ -0,0 +1,40 @@
+#ifndef PCG_SOLVER_HPP
+#define PCG_SOLVER_HPP
+
+#include "levMarqSchur.hpp"
+
+namespace cvfork
+{
+
+/*
+ * Inexact Newton variant of the block Levenberg-Marquardt solver: every damped step is solved
+ * approximately by conjugate gradients preconditioned with the inverted intrinsic and per-view
+ * extrinsic blocks. The normal matrix enters only through products with its stored blocks,
+ * so neither the full matrix nor the reduced camera system is built. The relative residual
+ * of CG is min(0.1, sqrt(|g|/|g0|)) of the gradient, which tightens as the solver converges.
+ */
+class CvLevMarqPCG : public CvLevMarqSchur
+{
+public:
+    CvLevMarqPCG( int nviews, CvTermCriteria criteria=
+              cvTermCriteria(CV_TERMCRIT_EPS+CV_TERMCRIT_ITER,30,DBL_EPSILON) );
+    virtual void step();
+    virtual ~CvLevMarqPCG();
+
+    // total number of conjugate gradient iterations
+    int cgIterations;
+
+protected:
+    // y = (JtJ + lambda*diag(JtJ))*x in the compacted layout
+    void multiplyNormal( double lambda, const double* x, double* y ) const;
+    // z = M^-1*r, M is the damped block diagonal of the normal matrix
+    void applyPreconditioner( const double* r, double* z ) const;
+
+    double firstGradNorm;
+    Mat intrinsicInv;
+    Mat x, r, z, p, q;
+};
+
+}
+
+#endif
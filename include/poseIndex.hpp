@@ -0,0 +1,44 @@
+#ifndef POSE_INDEX_HPP
+#define POSE_INDEX_HPP
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+namespace calib {
+
+// Captured views binned by the board pose: its pitch and yaw, its apparent size and the image
+// region of its center. The bins follow the views of the observation store; a view that falls
+// into a full bin slows down every later calibration and adds almost no information
+class poseIndex
+{
+protected:
+    int mBinCapacity;
+    std::vector<int> mViewBins;
+    std::vector<int> mBinCounts;
+public:
+    // 20 degree bins over the tilts accepted at capture time
+    static const int angleBins = 4;
+    static const int scaleBins = 3;
+    static const int regionGridSize = 3;
+    static const int binsCount = angleBins*angleBins*scaleBins*regionGridSize*regionGridSize;
+
+    poseIndex();
+
+    // views per bin, 0 for no limit
+    void setBinCapacity(int capacity);
+    // tilts are in degrees, 0 is fronto-parallel, points are the CV_32FC2 view points
+    static int binOf(double pitch, double yaw, const cv::Mat& points, cv::Size imageSize);
+    bool isSaturated(int bin) const;
+
+    void addView(int bin);
+    void removeView(size_t index);
+    // indices are sorted, the order of the views is kept
+    void keepViews(const std::vector<size_t>& indices);
+    void clear();
+    size_t viewsCount() const;
+    int viewBin(size_t index) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef PROJECTION_HPP
+#define PROJECTION_HPP
+
+#include <opencv2/core.hpp>
+
+namespace cvfork {
+
+enum DistortionModel { DISTORTION_5 = 0, DISTORTION_RATIONAL = 1, DISTORTION_THIN_PRISM = 2, DISTORTION_TILTED = 3 };
+
+/*
+ * Projects the points of a single view and computes the derivatives of the reprojection errors
+ * in one pass, same as cvProjectPoints2 followed by cvSub. Points are stored as separate coordinate
+ * arrays (SoA) and processed with SIMD when it's available.
+ * Residuals are laid out as [x errors of all points, y errors of all points], the Jacobians are stored
+ * transposed in the same order: 6 rows of extrinsics ([rvec, tvec]) and one row per intrinsic
+ * ([fx, fy, cx, cy, k1 ... tauY]) placed at intrinsicRows[param], intrinsics with a negative row are
+ * skipped. JeT == 0 means that only residuals are computed. distCoeffs must hold 14 values.
+ * The float variant keeps points, residuals and Jacobians in single precision and processes
+ * twice as many points per SIMD register, the camera parameters stay double.
+ */
+template<typename T> struct ProjectViewPoints
+{
+    typedef void (*Func)( const T* objX, const T* objY, const T* objZ,
+                          const T* imgX, const T* imgY, int npoints,
+                          const double* rvec, const double* tvec, const cv::Matx33d& cameraMatrix,
+                          const double* distCoeffs, double aspectRatio, T* err,
+                          T* JeT, size_t jeStep, T* JiT, size_t jiStep,
+                          const int* intrinsicRows );
+};
+typedef ProjectViewPoints<double>::Func ProjectViewPointsFunc;
+typedef ProjectViewPoints<float>::Func ProjectViewPointsFunc32f;
+
+// the simplest model covering the coefficients which are variable or non-zero
+int selectDistortionModel( int flags, const double* distCoeffs, int ndistCoeffs );
+
+// kernel specialized for the distortion model and fixed aspect ratio / principal point from flags
+ProjectViewPointsFunc getProjectViewPointsFunc( int distortionModel, int flags );
+ProjectViewPointsFunc32f getProjectViewPointsFunc32f( int distortionModel, int flags );
+
+}
+
+#endif
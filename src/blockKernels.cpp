@@ -0,0 +1,137 @@
+#include "blockKernels.hpp"
+#include "cvCalibrationFork.hpp"
+#include <opencv2/core/hal/intrin.hpp>
+
+using namespace cv;
+
+static inline double dot(const double* a, const double* b, int len)
+{
+    int i = 0;
+    double s = 0;
+#if CV_SIMD128_64F
+    v_float64x2 s0 = v_setall_f64(0.), s1 = v_setall_f64(0.);
+    for( ; i <= len - 4; i += 4 )
+    {
+        s0 += v_load(a + i)*v_load(b + i);
+        s1 += v_load(a + i + 2)*v_load(b + i + 2);
+    }
+    double buf[2];
+    v_store(buf, s0 + s1);
+    s = buf[0] + buf[1];
+#endif
+    for( ; i < len; i++ )
+        s += a[i]*b[i];
+    return s;
+}
+
+// products are accumulated in single precision, the sum is returned as double
+static inline double dot(const float* a, const float* b, int len)
+{
+    int i = 0;
+    float s = 0;
+#if CV_SIMD128
+    v_float32x4 s0 = v_setall_f32(0.f), s1 = v_setall_f32(0.f);
+    for( ; i <= len - 8; i += 8 )
+    {
+        s0 += v_load(a + i)*v_load(b + i);
+        s1 += v_load(a + i + 4)*v_load(b + i + 4);
+    }
+    float buf[4];
+    v_store(buf, s0 + s1);
+    s = (buf[0] + buf[1]) + (buf[2] + buf[3]);
+#endif
+    for( ; i < len; i++ )
+        s += a[i]*b[i];
+    return s;
+}
+
+template<int M, typename T>
+static void multiplyTransposedSelfImpl(const T* A, size_t astep, int len, double* C, size_t cstep)
+{
+    for( int a = 0; a < M; a++ )
+        for( int b = a; b < M; b++ )
+            C[a*cstep + b] = C[b*cstep + a] = dot(A + a*astep, A + b*astep, len);
+}
+
+template<int M, typename T>
+static void multiplyTransposedExtrinsicImpl(const T* A, size_t astep, const T* B, size_t bstep,
+                                            int len, double* C, size_t cstep)
+{
+    for( int a = 0; a < M; a++ )
+        for( int b = 0; b < 6; b++ )
+            C[a*cstep + b] = dot(A + a*astep, B + b*bstep, len);
+}
+
+template<int M, typename T>
+static void multiplyVectorImpl(const T* A, size_t astep, const T* b, int len, double* c, size_t cstep)
+{
+    for( int a = 0; a < M; a++ )
+        c[a*cstep] = dot(A + a*astep, b, len);
+}
+
+#define BLOCK_KERNELS(impl, T) { 0, impl<1, T>, impl<2, T>, impl<3, T>, impl<4, T>, impl<5, T>, impl<6, T>, \
+    impl<7, T>, impl<8, T>, impl<9, T>, impl<10, T>, impl<11, T>, impl<12, T>, impl<13, T>, impl<14, T>, \
+    impl<15, T>, impl<16, T>, impl<17, T>, impl<18, T> }
+
+template<typename T>
+static void multiplyTransposedSelf_(const T* A, size_t astep, int m, int len, double* C, size_t cstep)
+{
+    typedef void (*Func)(const T*, size_t, int, double*, size_t);
+    static const Func funcs[CV_CALIB_NINTRINSIC + 1] = BLOCK_KERNELS(multiplyTransposedSelfImpl, T);
+    CV_Assert( 0 <= m && m <= CV_CALIB_NINTRINSIC );
+    if( m > 0 )
+        funcs[m](A, astep, len, C, cstep);
+}
+
+template<typename T>
+static void multiplyTransposedExtrinsic_(const T* A, size_t astep, int m, const T* B, size_t bstep,
+                                         int len, double* C, size_t cstep)
+{
+    typedef void (*Func)(const T*, size_t, const T*, size_t, int, double*, size_t);
+    static const Func funcs[CV_CALIB_NINTRINSIC + 1] = BLOCK_KERNELS(multiplyTransposedExtrinsicImpl, T);
+    CV_Assert( 0 <= m && m <= CV_CALIB_NINTRINSIC );
+    if( m > 0 )
+        funcs[m](A, astep, B, bstep, len, C, cstep);
+}
+
+template<typename T>
+static void multiplyVector_(const T* A, size_t astep, int m, const T* b, int len, double* c, size_t cstep)
+{
+    typedef void (*Func)(const T*, size_t, const T*, int, double*, size_t);
+    static const Func funcs[CV_CALIB_NINTRINSIC + 1] = BLOCK_KERNELS(multiplyVectorImpl, T);
+    CV_Assert( 0 <= m && m <= CV_CALIB_NINTRINSIC );
+    if( m > 0 )
+        funcs[m](A, astep, b, len, c, cstep);
+}
+
+void cvfork::multiplyTransposedSelf(const double* A, size_t astep, int m, int len, double* C, size_t cstep)
+{
+    multiplyTransposedSelf_(A, astep, m, len, C, cstep);
+}
+
+void cvfork::multiplyTransposedSelf(const float* A, size_t astep, int m, int len, double* C, size_t cstep)
+{
+    multiplyTransposedSelf_(A, astep, m, len, C, cstep);
+}
+
+void cvfork::multiplyTransposedExtrinsic(const double* A, size_t astep, int m, const double* B, size_t bstep,
+                                         int len, double* C, size_t cstep)
+{
+    multiplyTransposedExtrinsic_(A, astep, m, B, bstep, len, C, cstep);
+}
+
+void cvfork::multiplyTransposedExtrinsic(const float* A, size_t astep, int m, const float* B, size_t bstep,
+                                         int len, double* C, size_t cstep)
+{
+    multiplyTransposedExtrinsic_(A, astep, m, B, bstep, len, C, cstep);
+}
+
+void cvfork::multiplyVector(const double* A, size_t astep, int m, const double* b, int len, double* c, size_t cstep)
+{
+    multiplyVector_(A, astep, m, b, len, c, cstep);
+}
+
+void cvfork::multiplyVector(const float* A, size_t astep, int m, const float* b, int len, double* c, size_t cstep)
+{
+    multiplyVector_(A, astep, m, b, len, c, cstep);
+}
@@ -3,36 +3,14 @@
 #include <algorithm>
 #include <cmath>
 #include <ctime>
+#include <queue>
 #include <opencv2/calib3d.hpp>
 #include <opencv2/imgproc.hpp>
 
 double calib::calibController::estimateCoverageQuality()
 {
-    int gridSize = 10;
-    int xGridStep = mCalibData->imageSize.width / gridSize;
-    int yGridStep = mCalibData->imageSize.height / gridSize;
-    std::vector<int> pointsInCell(gridSize*gridSize);
-
-    std::fill(pointsInCell.begin(), pointsInCell.end(), 0);
-
-    for(auto it = mCalibData->imagePoints.begin(); it != mCalibData->imagePoints.cend(); ++it)
-        for(auto pointIt = (*it).begin(); pointIt != (*it).end(); ++pointIt) {
-            int i = (int)((*pointIt).x / xGridStep);
-            int j = (int)((*pointIt).y / yGridStep);
-            pointsInCell[i*gridSize + j]++;
-        }
-
-    for(auto it = mCalibData->allCharucoCorners.begin(); it != mCalibData->allCharucoCorners.cend(); ++it)
-        for(int l = 0; l < (*it).size[0]; l++) {
-            int i = (int)((*it).at<float>(l, 0) / xGridStep);
-            int j = (int)((*it).at<float>(l, 1) / yGridStep);
-            pointsInCell[i*gridSize + j]++;
-        }
-
-    cv::Mat mean, stdDev;
-    cv::meanStdDev(pointsInCell, mean, stdDev);
-
-    return mean.at<double>(0) / (stdDev.at<double>(0) + 1e-7);
+    mCalibData->coverage.setImageSize(mCalibData->imageSize, mCalibData->observations);
+    return mCalibData->coverage.quality();
 }
 
 calib::calibController::calibController() :
@@ -124,7 +102,7 @@ bool calib::calibController::getCommonCalibrationState() const
 
 bool calib::calibController::getFramesNumberState() const
 {
-    return std::max(mCalibData->imagePoints.size(), mCalibData->allCharucoCorners.size()) > mMinFramesNum;
+    return mCalibData->observations.viewsCount() > mMinFramesNum;
 }
 
 bool calib::calibController::getConfidenceIntrervalsState() const
@@ -142,40 +120,42 @@ int calib::calibController::getNewFlags() const
     return mCalibFlags;
 }
 
+void calib::calibController::setNewFlags(int flags)
+{
+    mCalibFlags = flags;
+}
+
 
 //////////////////// calibDataController
 
-double calib::calibDataController::estimateGridSubsetQuality(size_t excludedIndex)
+static void removeElement(cv::Mat& vec, size_t index)
 {
-    {
-        int gridSize = 10;
-        int xGridStep = mCalibData->imageSize.width / gridSize;
-        int yGridStep = mCalibData->imageSize.height / gridSize;
-        std::vector<int> pointsInCell(gridSize*gridSize);
-
-        std::fill(pointsInCell.begin(), pointsInCell.end(), 0);
-
-        for(size_t k = 0; k < mCalibData->imagePoints.size(); k++)
-            if(k != excludedIndex)
-                for(auto pointIt = mCalibData->imagePoints[k].begin(); pointIt != mCalibData->imagePoints[k].cend(); ++pointIt) {
-                    int i = (int)((*pointIt).x / xGridStep);
-                    int j = (int)((*pointIt).y / yGridStep);
-                    pointsInCell[i*gridSize + j]++;
-                }
-
-        for(size_t k = 0; k < mCalibData->allCharucoCorners.size(); k++)
-            if(k != excludedIndex)
-                for(int l = 0; l <  mCalibData->allCharucoCorners[k].size[0]; l++) {
-                    int i = (int)(mCalibData->allCharucoCorners[k].at<float>(l, 0) / xGridStep);
-                    int j = (int)(mCalibData->allCharucoCorners[k].at<float>(l, 1) / yGridStep);
-                    pointsInCell[i*gridSize + j]++;
-                }
-
-        cv::Mat mean, stdDev;
-        cv::meanStdDev(pointsInCell, mean, stdDev);
-
-        return mean.at<double>(0) / (stdDev.at<double>(0) + 1e-7);
-    }
+    size_t size = vec.total();
+    cv::Mat newVec = cv::Mat((int)size - 1, 1, CV_64F);
+    std::copy(vec.ptr<double>(0), vec.ptr<double>(0) + index, newVec.ptr<double>(0));
+    std::copy(vec.ptr<double>(0) + index + 1, vec.ptr<double>(0) + size, newVec.ptr<double>(0) + index);
+    vec = newVec;
+}
+
+template <typename T>
+static void keepElements(std::vector<T>& vec, const std::vector<size_t>& indices)
+{
+    std::vector<T> kept;
+    kept.reserve(indices.size());
+    for(auto it = indices.begin(); it != indices.end() && *it < vec.size(); ++it)
+        kept.push_back(vec[*it]);
+    vec.swap(kept);
+}
+
+static void keepElements(cv::Mat& vec, const std::vector<size_t>& indices)
+{
+    size_t size = vec.total(), keptSize = 0;
+    while(keptSize < indices.size() && indices[keptSize] < size)
+        keptSize++;
+    cv::Mat newVec = cv::Mat((int)keptSize, 1, CV_64F);
+    for(size_t i = 0; i < keptSize; i++)
+        newVec.at<double>((int)i) = vec.at<double>((int)indices[i]);
+    vec = newVec;
 }
 
 calib::calibDataController::calibDataController(Sptr<calib::calibrationData> data, int maxFrames, double convParameter) :
@@ -192,15 +172,21 @@ calib::calibDataController::calibDataController()
 
 void calib::calibDataController::filterFrames()
 {
-    size_t numberOfFrames = std::max(mCalibData->allCharucoIds.size(), mCalibData->imagePoints.size());
+    size_t numberOfFrames = mCalibData->observations.viewsCount();
     CV_Assert(numberOfFrames == mCalibData->perViewErrors.total());
     if(numberOfFrames >= mMaxFramesNum) {
 
-        double worstValue = -HUGE_VAL, maxQuality = estimateGridSubsetQuality(numberOfFrames);
+        // leave-one-out errors also account for how much a view pulls the intrinsics towards itself
+        const cv::Mat& viewErrors = mCalibData->perViewLooErrors.total() == numberOfFrames ?
+                    mCalibData->perViewLooErrors : mCalibData->perViewErrors;
+        coverageIndex& coverage = mCalibData->coverage;
+        CV_Assert(coverage.framesCount() == numberOfFrames);
+        coverage.setImageSize(mCalibData->imageSize, mCalibData->observations);
+        double worstValue = -HUGE_VAL, maxQuality = coverage.quality();
         size_t worstElemIndex = 0;
         for(size_t i = 0; i < numberOfFrames; i++) {
-            double gridQDelta = estimateGridSubsetQuality(i) - maxQuality;
-            double currentValue = mCalibData->perViewErrors.at<double>(i)*mAlpha + gridQDelta*(1. - mAlpha);
+            double gridQDelta = coverage.qualityWithout(i) - maxQuality;
+            double currentValue = viewErrors.at<double>(i)*mAlpha + gridQDelta*(1. - mAlpha);
             if(currentValue > worstValue) {
                 worstValue = currentValue;
                 worstElemIndex = i;
@@ -208,24 +194,103 @@ void calib::calibDataController::filterFrames()
         }
         showOverlayMessage(cv::format("Frame %d is worst", worstElemIndex + 1));
 
-        if(mCalibData->imagePoints.size()) {
-            mCalibData->imagePoints.erase(mCalibData->imagePoints.begin() + worstElemIndex);
-            mCalibData->objectPoints.erase(mCalibData->objectPoints.begin() + worstElemIndex);
-        }
-        else {
-            mCalibData->allCharucoCorners.erase(mCalibData->allCharucoCorners.begin() + worstElemIndex);
-            mCalibData->allCharucoIds.erase(mCalibData->allCharucoIds.begin() + worstElemIndex);
+        mCalibData->observations.removeView(worstElemIndex);
+        coverage.removeFrame(worstElemIndex);
+        mCalibData->poses.removeView(worstElemIndex);
+        if(worstElemIndex < mCalibData->rvecs.size()) {
+            mCalibData->rvecs.erase(mCalibData->rvecs.begin() + worstElemIndex);
+            mCalibData->tvecs.erase(mCalibData->tvecs.begin() + worstElemIndex);
         }
 
-        cv::Mat newErrorsVec = cv::Mat(numberOfFrames - 1, 1, CV_64F);
-        //std::copy_n(mCalibData->perViewErrors.ptr<double>(0), worstElemIndex, newErrorsVec.ptr<double>(0));
-        std::copy(mCalibData->perViewErrors.ptr<double>(0),
-                  mCalibData->perViewErrors.ptr<double>(worstElemIndex), newErrorsVec.ptr<double>(0));
+        removeElement(mCalibData->perViewErrors, worstElemIndex);
+        if(mCalibData->perViewLooErrors.total() == numberOfFrames)
+            removeElement(mCalibData->perViewLooErrors, worstElemIndex);
+    }
+}
 
-        std::copy(mCalibData->perViewErrors.ptr<double>(worstElemIndex + 1), mCalibData->perViewErrors.ptr<double>(numberOfFrames),
-                    newErrorsVec.ptr<double>(worstElemIndex));
-        mCalibData->perViewErrors = newErrorsVec;
+void calib::calibDataController::selectFrames()
+{
+    size_t numberOfFrames = mCalibData->observations.viewsCount();
+    if(numberOfFrames <= mMaxFramesNum)
+        return;
+
+    coverageIndex& coverage = mCalibData->coverage;
+    const poseIndex& poses = mCalibData->poses;
+    CV_Assert(coverage.framesCount() == numberOfFrames && poses.viewsCount() == numberOfFrames);
+    coverage.setImageSize(mCalibData->imageSize, mCalibData->observations);
+
+    // views of the last calibration come first, the new ones get their mean error
+    const cv::Mat& knownErrors = mCalibData->perViewLooErrors.total() == mCalibData->perViewErrors.total() ?
+                mCalibData->perViewLooErrors : mCalibData->perViewErrors;
+    size_t knownErrorsNum = std::min(knownErrors.total(), numberOfFrames);
+    double meanError = 0;
+    for(size_t i = 0; i < knownErrorsNum; i++)
+        meanError += knownErrors.at<double>((int)i);
+    meanError = knownErrorsNum ? std::max(meanError / knownErrorsNum, 1e-7) : 1.;
+
+    double meanPoints = 0;
+    std::vector<int> poseBins(numberOfFrames);
+    std::vector<double> errorTerms(numberOfFrames);
+    for(size_t i = 0; i < numberOfFrames; i++) {
+        const std::vector<int>& cells = coverage.frameCells(i);
+        for(auto it = cells.begin(); it != cells.end(); ++it)
+            meanPoints += *it;
+        poseBins[i] = poses.viewBin(i);
+        errorTerms[i] = (i < knownErrorsNum ? knownErrors.at<double>((int)i) : meanError) / meanError;
     }
+    meanPoints = std::max(meanPoints / numberOfFrames, 1.);
+
+    // objective is the concave coverage of the image grid and of the pose bins minus the view errors,
+    // so marginal gains only decrease as frames are selected and stale gains are upper bounds
+    std::vector<int> selectedCells(coverageIndex::gridSize*coverageIndex::gridSize, 0);
+    std::vector<int> selectedPoses(poseIndex::binsCount, 0);
+    auto frameGain = [&](size_t i) {
+        const std::vector<int>& cells = coverage.frameCells(i);
+        double coverageGain = 0;
+        for(size_t c = 0; c < cells.size(); c++)
+            if(cells[c])
+                coverageGain += std::sqrt((double)(selectedCells[c] + cells[c])) - std::sqrt((double)selectedCells[c]);
+        double poseGain = std::sqrt(selectedPoses[poseBins[i]] + 1.) - std::sqrt((double)selectedPoses[poseBins[i]]);
+        return (coverageGain / std::sqrt(meanPoints) + poseGain)*(1. - mAlpha) - errorTerms[i]*mAlpha;
+    };
+
+    std::priority_queue<std::pair<double, size_t>> candidates;
+    std::vector<size_t> evaluatedAt(numberOfFrames, 0), selected;
+    for(size_t i = 0; i < numberOfFrames; i++)
+        candidates.push(std::make_pair(frameGain(i), i));
+    selected.reserve(mMaxFramesNum);
+    while(selected.size() < mMaxFramesNum && !candidates.empty()) {
+        size_t i = candidates.top().second;
+        candidates.pop();
+        if(evaluatedAt[i] == selected.size()) {
+            selected.push_back(i);
+            const std::vector<int>& cells = coverage.frameCells(i);
+            for(size_t c = 0; c < cells.size(); c++)
+                selectedCells[c] += cells[c];
+            selectedPoses[poseBins[i]]++;
+        }
+        else {
+            evaluatedAt[i] = selected.size();
+            candidates.push(std::make_pair(frameGain(i), i));
+        }
+    }
+    std::sort(selected.begin(), selected.end());
+
+    std::vector<bool> isSelected(numberOfFrames, false);
+    for(auto it = selected.begin(); it != selected.end(); ++it)
+        isSelected[*it] = true;
+    for(size_t i = numberOfFrames; i-- > 0;)
+        if(!isSelected[i])
+            coverage.removeFrame(i);
+
+    mCalibData->observations.keepViews(selected);
+    mCalibData->poses.keepViews(selected);
+    keepElements(mCalibData->rvecs, selected);
+    keepElements(mCalibData->tvecs, selected);
+    keepElements(mCalibData->perViewErrors, selected);
+    keepElements(mCalibData->perViewLooErrors, selected);
+
+    showOverlayMessage(cv::format("%d of %d frames selected", (int)selected.size(), (int)numberOfFrames));
 }
 
 void calib::calibDataController::setParametersFileName(const std::string &name)
@@ -235,14 +300,17 @@ void calib::calibDataController::setParametersFileName(const std::string &name)
 
 void calib::calibDataController::deleteLastFrame()
 {
-    if( !mCalibData->imagePoints.empty()) {
-        mCalibData->imagePoints.pop_back();
-        mCalibData->objectPoints.pop_back();
-    }
-
-    if (!mCalibData->allCharucoCorners.empty()) {
-        mCalibData->allCharucoCorners.pop_back();
-        mCalibData->allCharucoIds.pop_back();
+    if(mCalibData->observations.viewsCount())
+        mCalibData->observations.removeView(mCalibData->observations.viewsCount() - 1);
+
+    size_t numberOfFrames = mCalibData->observations.viewsCount();
+    if(mCalibData->coverage.framesCount() > numberOfFrames)
+        mCalibData->coverage.removeFrame(numberOfFrames);
+    if(mCalibData->poses.viewsCount() > numberOfFrames)
+        mCalibData->poses.removeView(numberOfFrames);
+    if(mCalibData->rvecs.size() > numberOfFrames) {
+        mCalibData->rvecs.resize(numberOfFrames);
+        mCalibData->tvecs.resize(numberOfFrames);
     }
 
     if(!mParamsStack.empty()) {
@@ -265,10 +333,11 @@ void calib::calibDataController::rememberCurrentParameters()
 
 void calib::calibDataController::deleteAllData()
 {
-    mCalibData->imagePoints.clear();
-    mCalibData->objectPoints.clear();
-    mCalibData->allCharucoCorners.clear();
-    mCalibData->allCharucoIds.clear();
+    mCalibData->observations.clear();
+    mCalibData->coverage.clear();
+    mCalibData->poses.clear();
+    mCalibData->rvecs.clear();
+    mCalibData->tvecs.clear();
     mCalibData->cameraMatrix = mCalibData->distCoeffs = cv::Mat();
     mParamsStack = std::stack<cameraParameters>();
     rememberCurrentParameters();
@@ -286,7 +355,7 @@ bool calib::calibDataController::saveCurrentCameraParameters() const
                 strftime(buf, sizeof(buf)-1, "%c", localtime(&rawtime));
 
                 parametersWriter << "calibrationDate" << buf;
-                parametersWriter << "framesCount" << std::max((int)mCalibData->objectPoints.size(), (int)mCalibData->allCharucoCorners.size());
+                parametersWriter << "framesCount" << (int)mCalibData->observations.viewsCount();
                 parametersWriter << "cameraResolution" << mCalibData->imageSize;
                 parametersWriter << "cameraMatrix" << mCalibData->cameraMatrix;
                 parametersWriter << "cameraMatrix_std_dev" << mCalibData->stdDeviations.rowRange(cv::Range(0, 4));
@@ -305,7 +374,7 @@ void calib::calibDataController::printParametersToConsole(std::ostream &output)
 {
     const char* border = "---------------------------------------------------";
     output << border << std::endl;
-    output << "Frames used for calibration: " << std::max(mCalibData->objectPoints.size(), mCalibData->allCharucoCorners.size())
+    output << "Frames used for calibration: " << mCalibData->observations.viewsCount()
            << " \t RMS = " << mCalibData->totalAvgErr << std::endl;
     if(mCalibData->cameraMatrix.at<double>(0,0) == mCalibData->cameraMatrix.at<double>(1,1))
         output << "F = " << mCalibData->cameraMatrix.at<double>(1,1) << " +- " << sigmaMult*mCalibData->stdDeviations.at<double>(1) << std::endl;
@@ -0,0 +1,101 @@
+#include "coverageIndex.hpp"
+#include "calibCommon.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+calib::coverageIndex::coverageIndex() :
+    mImageSize(IMAGE_MAX_WIDTH, IMAGE_MAX_HEIGHT), mTotalCells(gridSize*gridSize, 0)
+{
+}
+
+int calib::coverageIndex::cellIndex(const cv::Point2f& point) const
+{
+    int xGridStep = std::max(mImageSize.width / gridSize, 1);
+    int yGridStep = std::max(mImageSize.height / gridSize, 1);
+    int i = std::min(std::max((int)(point.x / xGridStep), 0), gridSize - 1);
+    int j = std::min(std::max((int)(point.y / yGridStep), 0), gridSize - 1);
+    return i*gridSize + j;
+}
+
+void calib::coverageIndex::countFrame(const cv::Mat& points, std::vector<int>& cells) const
+{
+    CV_Assert(points.type() == CV_32FC2 && points.isContinuous());
+    cells.assign(gridSize*gridSize, 0);
+    const cv::Point2f* data = points.ptr<cv::Point2f>();
+    for(size_t i = 0; i < points.total(); i++)
+        cells[cellIndex(data[i])]++;
+}
+
+double calib::coverageIndex::quality(const std::vector<int>& cells, const std::vector<int>* excluded) const
+{
+    double sum = 0, sqSum = 0;
+    for(size_t k = 0; k < cells.size(); k++) {
+        double count = cells[k] - (excluded ? (*excluded)[k] : 0);
+        sum += count;
+        sqSum += count*count;
+    }
+    double mean = sum / cells.size();
+    double stdDev = std::sqrt(std::max(sqSum / cells.size() - mean*mean, 0.));
+
+    return mean / (stdDev + 1e-7);
+}
+
+void calib::coverageIndex::setImageSize(cv::Size size, const observationStore& observations)
+{
+    if(size == mImageSize)
+        return;
+
+    CV_Assert(observations.viewsCount() == mFrameCells.size());
+    mImageSize = size;
+    std::fill(mTotalCells.begin(), mTotalCells.end(), 0);
+    for(size_t i = 0; i < mFrameCells.size(); i++) {
+        countFrame(observations.viewPoints(i), mFrameCells[i]);
+        for(int k = 0; k < gridSize*gridSize; k++)
+            mTotalCells[k] += mFrameCells[i][k];
+    }
+}
+
+void calib::coverageIndex::addFrame(const cv::Mat& points)
+{
+    mFrameCells.push_back(std::vector<int>());
+    countFrame(points, mFrameCells.back());
+    for(int k = 0; k < gridSize*gridSize; k++)
+        mTotalCells[k] += mFrameCells.back()[k];
+}
+
+void calib::coverageIndex::removeFrame(size_t index)
+{
+    CV_Assert(index < mFrameCells.size());
+    for(int k = 0; k < gridSize*gridSize; k++)
+        mTotalCells[k] -= mFrameCells[index][k];
+    mFrameCells.erase(mFrameCells.begin() + index);
+}
+
+void calib::coverageIndex::clear()
+{
+    mFrameCells.clear();
+    std::fill(mTotalCells.begin(), mTotalCells.end(), 0);
+}
+
+size_t calib::coverageIndex::framesCount() const
+{
+    return mFrameCells.size();
+}
+
+const std::vector<int>& calib::coverageIndex::frameCells(size_t index) const
+{
+    CV_Assert(index < mFrameCells.size());
+    return mFrameCells[index];
+}
+
+double calib::coverageIndex::quality() const
+{
+    return quality(mTotalCells, nullptr);
+}
+
+double calib::coverageIndex::qualityWithout(size_t index) const
+{
+    CV_Assert(index < mFrameCells.size());
+    return quality(mTotalCells, &mFrameCells[index]);
+}
@@ -1,26 +1,383 @@
 #include <opencv2/calib3d.hpp>
 #include "linalg.hpp"
 #include "cvCalibrationFork.hpp"
+#include "levMarqSchur.hpp"
+#include "doglegSolver.hpp"
+#include "pcgSolver.hpp"
+#include "projection.hpp"
+#include "blockKernels.hpp"
+#include "distortionInit.hpp"
 
 using namespace cv;
 
-static void subMatrix(const cv::Mat& src, cv::Mat& dst, const std::vector<uchar>& cols,
-                      const std::vector<uchar>& rows);
+// relative parameter change at which mixed precision calibration switches to double kernels,
+// float residuals are accurate to ~1e-7 relative, so the switch happens well above their noise
+static const double MIXED_PRECISION_SWITCH_EPS = 1e-4;
+// the number of double precision iterations which are left at least
+static const int MIXED_PRECISION_REFINE_ITERS = 3;
+// every k-th Jacobian is computed analytically when Broyden updates are enabled
+static const int BROYDEN_FULL_JACOBIAN_PERIOD = 4;
+
 static const char* cvDistCoeffErr = "Distortion coefficients must be 1x4, 4x1, 1x5, 5x1, 1x8, 8x1, 1x12, 12x1, 1x14 or 14x1 floating-point vector";
 
+// Broyden rank-one update of the transposed Jacobian of a view: J += (dr - J*dx)*dx^t/(dx^t*dx),
+// dx holds the changes of the variable intrinsics followed by the 6 extrinsics of the view.
+// prevErr holds the residuals at the point of the previous Jacobian and is used as scratch.
+template<typename S>
+static void broydenUpdate(S* JiT, S* JeT, size_t jstep, int nintrinsic, const S* err, S* prevErr, int len,
+                          const double* dx)
+{
+    double dx2 = 0;
+    for( int p = 0; p < nintrinsic + 6; p++ )
+        dx2 += dx[p]*dx[p];
+    if( dx2 < DBL_EPSILON*DBL_EPSILON )
+        return;
+
+    for( int k = 0; k < len; k++ )
+        prevErr[k] = err[k] - prevErr[k];
+    for( int p = 0; p < nintrinsic + 6; p++ )
+    {
+        const S* J = p < nintrinsic ? JiT + p*jstep : JeT + (p - nintrinsic)*jstep;
+        S d = (S)dx[p];
+        for( int k = 0; k < len; k++ )
+            prevErr[k] -= J[k]*d;
+    }
+    for( int p = 0; p < nintrinsic + 6; p++ )
+    {
+        S* J = p < nintrinsic ? JiT + p*jstep : JeT + (p - nintrinsic)*jstep;
+        S d = (S)(dx[p]/dx2);
+        for( int k = 0; k < len; k++ )
+            J[k] += prevErr[k]*d;
+    }
+}
+
+// Projects a range of views and fills their blocks of the normal equations. Contributions of the views
+// to the intrinsic block are stored separately and summed up by the caller in view order, so the result
+// doesn't depend on how the views are split between threads.
+class CalibrateViewsInvoker : public ParallelLoopBody
+{
+public:
+    CalibrateViewsInvoker(cvfork::CvLevMarqFork& _solver, const Mat& _objPoints, const Mat& _imgPoints,
+                          const std::vector<int>& _viewOffsets, const Matx33d& _cameraMatrix, const double* _distCoeffs,
+                          int _flags, double _aspectRatio, const Mat& _allErrors, bool _storeErrors,
+                          const Mat& _viewJtJ, const Mat& _viewJtErr, std::vector<double>& _viewErrNorms) :
+        solver(_solver), viewOffsets(_viewOffsets), cameraMatrix(_cameraMatrix), distCoeffs(_distCoeffs),
+        flags(_flags), aspectRatio(_aspectRatio), allErrors(_allErrors),
+        storeErrors(_storeErrors), viewJtJ(_viewJtJ), viewJtErr(_viewJtErr), viewErrNorms(_viewErrNorms),
+        singlePrecision((_flags & CALIB_USE_MIXED_PRECISION) != 0), jacobianUpdate(false)
+    {
+        // The points are copied once more, as coordinate rows: the vectorized projection kernels load
+        // consecutive x (y, z) values of a view into one register, which interleaved points don't allow.
+        // Mixed precision keeps a float copy of these rows as well, the double one is needed after the switch
+        std::vector<Mat> objCoords(3), imgCoords(2);
+        buf64f.objPoints.create(3, _objPoints.cols, CV_64F);
+        buf64f.imgPoints.create(2, _imgPoints.cols, CV_64F);
+        for( int j = 0; j < 3; j++ )
+            objCoords[j] = buf64f.objPoints.row(j);
+        for( int j = 0; j < 2; j++ )
+            imgCoords[j] = buf64f.imgPoints.row(j);
+        split(_objPoints, objCoords);
+        split(_imgPoints, imgCoords);
+        buf64f.allocate(CV_64F, flags);
+
+        // distortion model and fixed intrinsics don't change during the calibration
+        int model = cvfork::selectDistortionModel(flags, distCoeffs, 14);
+        projectViewPoints = cvfork::getProjectViewPointsFunc(model, flags);
+
+        if( singlePrecision )
+        {
+            buf64f.objPoints.convertTo(buf32f.objPoints, CV_32F);
+            buf64f.imgPoints.convertTo(buf32f.imgPoints, CV_32F);
+            buf32f.allocate(CV_32F, flags);
+            projectViewPoints32f = cvfork::getProjectViewPointsFunc32f(model, flags);
+        }
+    }
+
+    virtual void operator()(const Range& range) const
+    {
+        if( singlePrecision )
+            calibrateViews<float>(range, buf32f, projectViewPoints32f);
+        else
+            calibrateViews<double>(range, buf64f, projectViewPoints);
+    }
+
+    // the rest of the optimization uses double precision kernels
+    void switchToDoublePrecision()
+    {
+        singlePrecision = false;
+    }
+
+    bool isSinglePrecision() const
+    {
+        return singlePrecision;
+    }
+
+    // the next Jacobian is obtained by Broyden update of the previous one instead of the analytic one
+    void setJacobianUpdate(bool update)
+    {
+        jacobianUpdate = update;
+    }
+
+private:
+    // SoA points, transposed Jacobians (one row per parameter) and residuals of all views in one precision.
+    // Views use disjoint columns, so nothing is allocated during the optimization
+    struct Buffers
+    {
+        Mat objPoints, imgPoints; // coordinates stored row by row
+        Mat jacobians, errors;
+        Mat jacobianErrors;       // residuals at the point of the last Jacobian, for Broyden updates
+
+        void allocate(int type, int flags)
+        {
+            jacobians = Mat::zeros(CV_CALIB_NINTRINSIC + 6, objPoints.cols*2, type);
+            errors.create(objPoints.cols*2, 1, type);
+            if( flags & CALIB_USE_BROYDEN )
+                jacobianErrors.create(objPoints.cols*2, 1, type);
+        }
+    };
+
+    template<typename S>
+    void calibrateViews(const Range& range, const Buffers& buf,
+                        typename cvfork::ProjectViewPoints<S>::Func project) const
+    {
+        const int NINTRINSIC = CV_CALIB_NINTRINSIC;
+        bool calcJ = solver.state == CvLevMarq::CALC_J;
+        bool updateJ = calcJ && jacobianUpdate;
+        const std::vector<int>& intrinsicIdx = solver.intrinsicIndex();
+        int nintrinsic = (int)intrinsicIdx.size();
+        const double *params = solver.param->data.db, *prevParams = solver.prevParam->data.db;
+
+        // only variable intrinsics take part in the normal equations
+        int intrinsicRows[NINTRINSIC];
+        double dx[NINTRINSIC + 6];
+        std::fill(intrinsicRows, intrinsicRows + NINTRINSIC, -1);
+        for( int j = 0; j < nintrinsic; j++ )
+        {
+            intrinsicRows[intrinsicIdx[j]] = j;
+            dx[j] = params[intrinsicIdx[j]] - prevParams[intrinsicIdx[j]];
+        }
+
+        for( int i = range.start; i < range.end; i++ )
+        {
+            int pos = viewOffsets[i], ni = viewOffsets[i + 1] - pos;
+            Mat JiT = buf.jacobians(Rect(pos*2, 0, ni*2, nintrinsic));
+            Mat JeT = buf.jacobians(Rect(pos*2, NINTRINSIC, ni*2, 6));
+            Mat _err = buf.errors.rowRange(pos*2, (pos + ni)*2);
+            const double* param = params + NINTRINSIC + i*6;
+            size_t jstep = buf.jacobians.step1();
+
+            project( buf.objPoints.ptr<S>(0) + pos, buf.objPoints.ptr<S>(1) + pos, buf.objPoints.ptr<S>(2) + pos,
+                     buf.imgPoints.ptr<S>(0) + pos, buf.imgPoints.ptr<S>(1) + pos, ni, param, param + 3,
+                     cameraMatrix, distCoeffs, aspectRatio, _err.ptr<S>(),
+                     calcJ && !updateJ ? JeT.ptr<S>() : 0, jstep, JiT.ptr<S>(), jstep, intrinsicRows );
+
+            if( calcJ && !buf.jacobianErrors.empty() )
+            {
+                Mat prevErr = buf.jacobianErrors.rowRange(pos*2, (pos + ni)*2);
+                if( updateJ )
+                {
+                    double dxv[NINTRINSIC + 6];
+                    std::copy(dx, dx + nintrinsic, dxv);
+                    for( int j = 0; j < 6; j++ )
+                        dxv[nintrinsic + j] = param[j] - prevParams[NINTRINSIC + i*6 + j];
+                    broydenUpdate(JiT.ptr<S>(), JeT.ptr<S>(), jstep, nintrinsic, _err.ptr<S>(),
+                                  prevErr.ptr<S>(), ni*2, dxv);
+                }
+                _err.copyTo(prevErr);
+            }
+
+            if( calcJ )
+            {
+                // see HZ: (A6.14) for details on the structure of the Jacobian
+                const S *ji = JiT.ptr<S>(), *je = JeT.ptr<S>(), *e = _err.ptr<S>();
+                Mat U = viewJtJ.rowRange(i*NINTRINSIC, (i + 1)*NINTRINSIC), V = solver.viewBlock(i);
+                Mat W = solver.couplingBlock(i), ei = viewJtErr.rowRange(i*NINTRINSIC, (i + 1)*NINTRINSIC);
+                Mat ee = solver.viewErr(i);
+
+                cvfork::multiplyTransposedSelf(ji, jstep, nintrinsic, ni*2, U.ptr<double>(), U.step1());
+                cvfork::multiplyTransposedSelf(je, jstep, 6, ni*2, V.ptr<double>(), V.step1());
+                cvfork::multiplyTransposedExtrinsic(ji, jstep, nintrinsic, je, jstep, ni*2, W.ptr<double>(), W.step1());
+                cvfork::multiplyVector(ji, jstep, nintrinsic, e, ni*2, ei.ptr<double>(), ei.step1());
+                cvfork::multiplyVector(je, jstep, 6, e, ni*2, ee.ptr<double>(), ee.step1());
+                if( storeErrors )
+                {
+                    // only norms of the errors are used, so the order of coordinates doesn't matter
+                    Mat _me = allErrors.colRange(pos, pos + ni);
+                    _err.reshape(2, 1).convertTo(_me, CV_64F);
+                }
+            }
+
+            viewErrNorms[i] = norm(_err, NORM_L2SQR);
+        }
+    }
+
+    cvfork::CvLevMarqFork& solver;
+    const std::vector<int>& viewOffsets;
+    const Matx33d& cameraMatrix;
+    const double* distCoeffs;
+    int flags;
+    double aspectRatio;
+    Mat allErrors;
+    bool storeErrors;
+    Mat viewJtJ, viewJtErr;
+    std::vector<double>& viewErrNorms;
+    bool singlePrecision, jacobianUpdate;
+    Buffers buf64f, buf32f;
+    cvfork::ProjectViewPointsFunc projectViewPoints;
+    cvfork::ProjectViewPointsFunc32f projectViewPoints32f;
+};
+
+// reads the pose of the view i passed in rvecs/tvecs, views with zero translation have no pose yet
+static bool readExtrinsicGuess(const CvMat* rvecs, const CvMat* tvecs, int i, int nimages, CvMat* _ri, CvMat* _ti)
+{
+    CvMat src;
+    if( rvecs->rows == nimages && rvecs->cols*CV_MAT_CN(rvecs->type) == 9 )
+    {
+        src = cvMat( 3, 3, CV_MAT_DEPTH(rvecs->type), rvecs->data.ptr + rvecs->step*i );
+        cvRodrigues2( &src, _ri );
+    }
+    else
+    {
+        src = cvMat( 3, 1, CV_MAT_DEPTH(rvecs->type), rvecs->rows == 1 ?
+            rvecs->data.ptr + i*CV_ELEM_SIZE(rvecs->type) :
+            rvecs->data.ptr + rvecs->step*i );
+        cvConvert( &src, _ri );
+    }
+
+    src = cvMat( 3, 1, CV_MAT_DEPTH(tvecs->type), tvecs->rows == 1 ?
+        tvecs->data.ptr + i*CV_ELEM_SIZE(tvecs->type) :
+        tvecs->data.ptr + tvecs->step*i );
+    cvConvert( &src, _ti );
+
+    return cvNorm( _ti ) > 0;
+}
+
+// Finds initial poses of a range of views. Every view writes only its own extrinsics,
+// so the result doesn't depend on the number of threads
+class InitExtrinsicsInvoker : public ParallelLoopBody
+{
+public:
+    InitExtrinsicsInvoker(CvMat* _param, const Mat& _objPoints, const Mat& _imgPoints,
+                          const std::vector<int>& _viewOffsets, const CvMat* _cameraMatrix,
+                          const CvMat* _distCoeffs, const CvMat* _rvecs, const CvMat* _tvecs) :
+        param(_param), objPoints(_objPoints), imgPoints(_imgPoints), viewOffsets(_viewOffsets),
+        cameraMatrix(_cameraMatrix), distCoeffs(_distCoeffs), rvecs(_rvecs), tvecs(_tvecs)
+    {
+    }
+
+    virtual void operator()(const Range& range) const
+    {
+        const int NINTRINSIC = CV_CALIB_NINTRINSIC;
+        int nimages = (int)viewOffsets.size() - 1;
+        for( int i = range.start; i < range.end; i++ )
+        {
+            CvMat _ri, _ti;
+            int pos = viewOffsets[i], ni = viewOffsets[i + 1] - pos;
+
+            cvGetRows( param, &_ri, NINTRINSIC + i*6, NINTRINSIC + i*6 + 3 );
+            cvGetRows( param, &_ti, NINTRINSIC + i*6 + 3, NINTRINSIC + i*6 + 6 );
+
+            CvMat _Mi(objPoints.colRange(pos, pos + ni));
+            CvMat _mi(imgPoints.colRange(pos, pos + ni));
+
+            if( !rvecs || !readExtrinsicGuess( rvecs, tvecs, i, nimages, &_ri, &_ti ) )
+                cvFindExtrinsicCameraParams2( &_Mi, &_mi, cameraMatrix, distCoeffs, &_ri, &_ti );
+        }
+    }
+
+private:
+    CvMat* param;
+    const Mat& objPoints;
+    const Mat& imgPoints;
+    const std::vector<int>& viewOffsets;
+    const CvMat* cameraMatrix;
+    const CvMat* distCoeffs;
+    const CvMat* rvecs;
+    const CvMat* tvecs;
+};
+
+// leave-one-out RMS error of every view: intrinsics are re-estimated without the view by removing its
+// contribution S_i = U_i - W_i*V_i^-1*W_i^t from the reduced camera system, then the pose of the view
+// is refitted to them. Everything is linearized at the last evaluated Jacobian.
+static void computeLeaveOneOutErrors(cvfork::CvLevMarqFork& solver, const Mat& viewJtJ, const Mat& viewJtErr,
+                                     const std::vector<double>& viewErrNorms, const std::vector<int>& viewOffsets,
+                                     double* looErrors)
+{
+    const int N = CV_CALIB_NINTRINSIC;
+    typedef Matx<double, N, N> MatxII;
+    typedef Matx<double, N, 6> MatxIE;
+    typedef Matx<double, N, 1> VecI;
+    typedef Matx<double, 6, 1> VecE;
+    int nimages = (int)viewErrNorms.size(), nintrinsic = (int)solver.intrinsicIndex().size();
+
+    std::vector<MatxII> U(nimages), Si(nimages);
+    std::vector<MatxIE> W(nimages);
+    std::vector<Matx66d> Vinv(nimages);
+    std::vector<VecI> gI(nimages), bi(nimages);
+    std::vector<VecE> ge(nimages);
+    MatxII S;
+    VecI b;
+
+    for( int i = 0; i < nimages; i++ )
+    {
+        Mat Vm = solver.viewBlock(i), Wm = solver.couplingBlock(i), em = solver.viewErr(i);
+        Matx66d V;
+        for( int k = 0; k < 6; k++ )
+        {
+            for( int l = 0; l < 6; l++ )
+                V(k, l) = Vm.at<double>(k, l);
+            ge[i](k) = em.at<double>(k);
+        }
+        for( int k = 0; k < nintrinsic; k++ )
+        {
+            for( int l = 0; l < 6; l++ )
+                W[i](k, l) = Wm.at<double>(k, l);
+            for( int l = 0; l < nintrinsic; l++ )
+                U[i](k, l) = viewJtJ.at<double>(i*N + k, l);
+            gI[i](k) = viewJtErr.at<double>(i*N + k);
+        }
+        cvfork::invertViewBlock(V.val, 1., Vinv[i]);
+        MatxIE Y = W[i]*Vinv[i];
+        Si[i] = U[i] - Y*W[i].t();
+        bi[i] = gI[i] - Y*ge[i];
+        S += Si[i];
+        b += bi[i];
+    }
+    for( int k = nintrinsic; k < N; k++ )
+        S(k, k) = 1;
+
+    for( int i = 0; i < nimages; i++ )
+    {
+        int ni = viewOffsets[i + 1] - viewOffsets[i];
+        MatxII A = S - Si[i], L = A;
+        VecI dI = bi[i] - b;
+        if( !cvfork::choleskySolve(L.val, N*sizeof(double), N, dI.val, sizeof(double), 1) )
+            cv::solve(A, bi[i] - b, dI, DECOMP_SVD);
+
+        VecE q = ge[i] + W[i].t()*dI;
+        double sse = viewErrNorms[i] + 2*gI[i].dot(dI) + dI.dot(U[i]*dI) - q.dot(Vinv[i]*q);
+        looErrors[i] = std::sqrt(std::max(sse, 0.)/ni);
+    }
+}
+
 double cvfork::cvCalibrateCamera2( const CvMat* objectPoints,
                     const CvMat* imagePoints, const CvMat* npoints,
                     CvSize imageSize, CvMat* cameraMatrix, CvMat* distCoeffs,
-                    CvMat* rvecs, CvMat* tvecs, CvMat* stdDevs, CvMat* perViewErrors, int flags, CvTermCriteria termCrit )
+                    CvMat* rvecs, CvMat* tvecs, CvMat* stdDevs, CvMat* perViewErrors, CvMat* perViewLooErrors,
+                    int flags, CvTermCriteria termCrit,
+                    SolverStats* stats, double timeBudget, const CvMat* pointIds )
 {
     const int NINTRINSIC = CV_CALIB_NINTRINSIC;
     double reprojErr = 0;
+    int64 startTick = getTickCount();
 
     Matx33d A;
     double k[14] = {0};
     CvMat matA = cvMat(3, 3, CV_64F, A.val), _k;
     int i, nimages, maxPoints = 0, ni = 0, pos, total = 0, nparams, npstep, cn;
     double aspectRatio = 0.;
+    if( stats )
+        *stats = SolverStats();
 
     // 0. check the parameters & allocate buffers
     if( !CV_IS_MAT(objectPoints) || !CV_IS_MAT(imagePoints) ||
@@ -78,12 +435,18 @@ double cvfork::cvCalibrateCamera2( const CvMat* objectPoints,
         cn = CV_MAT_CN(stdDevs->type);
         if( !CV_IS_MAT(stdDevs) ||
             (CV_MAT_DEPTH(stdDevs->type) != CV_32F && CV_MAT_DEPTH(stdDevs->type) != CV_64F) ||
-            ((stdDevs->rows != (nimages*6 + NINTRINSIC) || stdDevs->cols*cn != 1) &&
-            (stdDevs->rows != 1 || stdDevs->cols != (nimages*6 + NINTRINSIC) || cn != 1)) )
+            (stdDevs->rows*stdDevs->cols != (nimages*6 + NINTRINSIC) && stdDevs->rows*stdDevs->cols != NINTRINSIC) ||
+            (stdDevs->rows != 1 && stdDevs->cols*cn != 1) || cn != 1 )
             CV_Error( CV_StsBadArg, "the output array of standard deviations vectors must be 1-channel "
-                "1x(n*6 + NINTRINSIC) or (n*6 + NINTRINSIC)x1 array, where n is the number of views" );
+                "1x(n*6 + NINTRINSIC) or (n*6 + NINTRINSIC)x1 array, where n is the number of views, "
+                "or 1xNINTRINSIC or NINTRINSICx1 array for intrinsics only" );
     }
 
+    if( perViewLooErrors && (!CV_IS_MAT(perViewLooErrors) || CV_MAT_TYPE(perViewLooErrors->type) != CV_64FC1 ||
+        perViewLooErrors->rows*perViewLooErrors->cols != nimages || !CV_IS_MAT_CONT(perViewLooErrors->type)) )
+        CV_Error( CV_StsBadArg, "the output array of leave-one-out errors must be continuous "
+            "1-channel double precision 1xn or nx1 array, where n is the number of views" );
+
     if( (CV_MAT_TYPE(cameraMatrix->type) != CV_32FC1 &&
         CV_MAT_TYPE(cameraMatrix->type) != CV_64FC1) ||
         cameraMatrix->rows != 3 || cameraMatrix->cols != 3 )
@@ -111,25 +474,46 @@ double cvfork::cvCalibrateCamera2( const CvMat* objectPoints,
         total += ni;
     }
 
+    // Double precision AoS copies of the points. The initialization (cvInitIntrinsicParams2D, the division
+    // model, the initial extrinsics) works on them, and the optimization makes its own SoA copy below,
+    // so they are released as soon as the calibration invoker is built
     Mat matM( 1, total, CV_64FC3 );
     Mat _m( 1, total, CV_64FC2 );
 
-    if(CV_MAT_CN(objectPoints->type) == 3) {
-        cvarrToMat(objectPoints).convertTo(matM, CV_64F);
+    if( pointIds )
+    {
+        if( !CV_IS_MAT(pointIds) || CV_MAT_TYPE(pointIds->type) != CV_32SC1 ||
+            pointIds->rows*pointIds->cols != total || !CV_IS_MAT_CONT(pointIds->type) )
+            CV_Error( CV_StsBadArg, "the array of point ids must be continuous integer vector "
+                "with an id for every image point" );
+        // object points are gathered from the board model in the same pass as they're converted
+        Mat board;
+        cvarrToMat(objectPoints).reshape(3, 1).convertTo(board, CV_64F);
+        const Point3d* B = board.ptr<Point3d>();
+        const int* ids = pointIds->data.i;
+        Point3d* M = matM.ptr<Point3d>();
+        for( i = 0; i < total; i++ )
+        {
+            if( ids[i] < 0 || ids[i] >= (int)board.total() )
+                CV_Error_( CV_StsOutOfRange, ("Point id %d is out of the board model", ids[i]));
+            M[i] = B[ids[i]];
+        }
+    }
+    // the points are read as 1xN rows, an Nx1 column (e.g. a wrapped std::vector) is reshaped
+    // so that convertTo doesn't reallocate matM and _m with another shape
+    else if(CV_MAT_CN(objectPoints->type) == 3) {
+        cvarrToMat(objectPoints).reshape(3, 1).convertTo(matM, CV_64F);
     } else {
         convertPointsHomogeneous(cvarrToMat(objectPoints), matM);
     }
 
     if(CV_MAT_CN(imagePoints->type) == 2) {
-        cvarrToMat(imagePoints).convertTo(_m, CV_64F);
+        cvarrToMat(imagePoints).reshape(2, 1).convertTo(_m, CV_64F);
     } else {
         convertPointsHomogeneous(cvarrToMat(imagePoints), _m);
     }
 
     nparams = NINTRINSIC + nimages*6;
-    Mat _Ji( maxPoints*2, NINTRINSIC, CV_64FC1, Scalar(0));
-    Mat _Je( maxPoints*2, 6, CV_64FC1 );
-    Mat _err( maxPoints*2, 1, CV_64FC1 );
 
     _k = cvMat( distCoeffs->rows, distCoeffs->cols, CV_MAKETYPE(CV_64F,CV_MAT_CN(distCoeffs->type)), k);
     if( distCoeffs->rows*distCoeffs->cols*CV_MAT_CN(distCoeffs->type) < 8 )
@@ -138,6 +522,10 @@ double cvfork::cvCalibrateCamera2( const CvMat* objectPoints,
             flags |= CALIB_FIX_K3;
         flags |= CALIB_FIX_K4 | CALIB_FIX_K5 | CALIB_FIX_K6;
     }
+    std::vector<int> viewOffsets(nimages + 1, 0);
+    for( i = 0; i < nimages; i++ )
+        viewOffsets[i + 1] = viewOffsets[i] + npoints->data.i[i*npstep];
+
     const double minValidAspectRatio = 0.01;
     const double maxValidAspectRatio = 100.0;
 
@@ -189,17 +577,30 @@ double cvfork::cvCalibrateCamera2( const CvMat* objectPoints,
         }
         CvMat _matM(matM), m(_m);
         cvInitIntrinsicParams2D( &_matM, &m, npoints, imageSize, &matA, aspectRatio );
+        if( flags & CALIB_INIT_DIVISION_MODEL )
+            cvfork::initIntrinsicParamsDivisionModel( matM, _m, viewOffsets, Size(imageSize), aspectRatio, flags, A, k );
     }
 
     //CvLevMarq solver( nparams, 0, termCrit );
-    cvfork::CvLevMarqFork solver( nparams, 0, termCrit );
-    Mat JtJcopy, allErrors(1, total, CV_64FC2);
+    Ptr<cvfork::CvLevMarqFork> solverPtr;
+    Ptr<cvfork::CvLevMarqPCG> pcgSolver;
+    if( flags & CALIB_USE_DOGLEG )
+        solverPtr = makePtr<cvfork::CvDoglegFork>(nparams, termCrit);
+    else if( flags & CALIB_USE_PCG )
+        solverPtr = pcgSolver = makePtr<cvfork::CvLevMarqPCG>(nimages, termCrit);
+    else if( flags & CALIB_USE_SCHUR )
+        solverPtr = makePtr<cvfork::CvLevMarqSchur>(nimages, termCrit);
+    else
+        solverPtr = makePtr<cvfork::CvLevMarqFork>(nparams, 0, termCrit);
+    cvfork::CvLevMarqFork& solver = *solverPtr;
+    Mat allErrors(1, total, CV_64FC2);
 
     if(flags & CALIB_USE_LU) {
         solver.solveMethod = DECOMP_LU;
     }
     else if(flags & CALIB_USE_QR)
         solver.solveMethod = DECOMP_QR;
+    solver.reuseFactorization = (flags & CALIB_REUSE_FACTORIZATION) != 0;
 
     {
     double* param = solver.param->data.db;
@@ -210,6 +611,9 @@ double cvfork::cvCalibrateCamera2( const CvMat* objectPoints,
 
     if( flags & CV_CALIB_FIX_FOCAL_LENGTH )
         mask[0] = mask[1] = 0;
+    // fx is derived from fy, its Jacobian column is zero and would make the normal matrix singular
+    if( flags & CALIB_FIX_ASPECT_RATIO )
+        mask[0] = 0;
     if( flags & CV_CALIB_FIX_PRINCIPAL_POINT )
         mask[2] = mask[3] = 0;
     if( flags & CV_CALIB_ZERO_TANGENT_DIST )
@@ -246,21 +650,31 @@ double cvfork::cvCalibrateCamera2( const CvMat* objectPoints,
     }
 
     // 2. initialize extrinsic parameters
-    for( i = 0, pos = 0; i < nimages; i++, pos += ni )
-    {
-        CvMat _ri, _ti;
-        ni = npoints->data.i[i*npstep];
-
-        cvGetRows( solver.param, &_ri, NINTRINSIC + i*6, NINTRINSIC + i*6 + 3 );
-        cvGetRows( solver.param, &_ti, NINTRINSIC + i*6 + 3, NINTRINSIC + i*6 + 6 );
-
-        CvMat _Mi(matM.colRange(pos, pos + ni));
-        CvMat _mi(_m.colRange(pos, pos + ni));
-
-        cvFindExtrinsicCameraParams2( &_Mi, &_mi, &matA, &_k, &_ri, &_ti );
-    }
+    bool useExtrinsicGuess = (flags & CALIB_FORK_USE_EXTRINSIC_GUESS) && (flags & CALIB_USE_INTRINSIC_GUESS) &&
+            rvecs && tvecs;
+    InitExtrinsicsInvoker initExtrinsics(solver.param, matM, _m, viewOffsets, &matA, &_k,
+                                         useExtrinsicGuess ? rvecs : 0, useExtrinsicGuess ? tvecs : 0);
+    if( flags & CALIB_USE_PARALLEL )
+        parallel_for_(Range(0, nimages), initExtrinsics, getNumThreads());
+    else
+        initExtrinsics(Range(0, nimages));
 
     // 3. run the optimization
+    Mat viewJtJ(nimages*NINTRINSIC, NINTRINSIC, CV_64F), viewJtErr(nimages*NINTRINSIC, 1, CV_64F);
+    std::vector<double> viewErrNorms(nimages);
+    CalibrateViewsInvoker calibrateViews(solver, matM, _m, viewOffsets, A, k, flags,
+                                         (flags & CALIB_FIX_ASPECT_RATIO) ? aspectRatio : 0,
+                                         allErrors, stdDevs != 0, viewJtJ, viewJtErr, viewErrNorms);
+    matM.release();
+    _m.release();
+
+    // in mixed precision mode the solver may stop only after the switch to double kernels
+    double solverEps = solver.criteria.epsilon;
+    if( calibrateViews.isSinglePrecision() )
+        solver.criteria.epsilon = 0;
+    // Broyden updates since the last analytic Jacobian, error evaluations since the last Jacobian
+    int jacobianUpdates = -1, errorChecks = 0;
+
     for(;;)
     {
         const CvMat* _param = 0;
@@ -269,6 +683,32 @@ double cvfork::cvCalibrateCamera2( const CvMat* objectPoints,
         bool proceed = solver.updateAlt( _param, _JtJ, _JtErr, _errNorm );
         double *param = solver.param->data.db, *pparam = solver.prevParam->data.db;
 
+        // float kernels are used until the steps get close to their precision, the last iterations
+        // are refined in double, so the result matches the double precision one within solverEps
+        if( calibrateViews.isSinglePrecision() && solver.state == CvLevMarq::CALC_J && solver.iters > 0 &&
+            (solver.iters >= solver.criteria.max_iter - MIXED_PRECISION_REFINE_ITERS ||
+             cvNorm(solver.param, solver.prevParam, CV_RELATIVE_L2) < MIXED_PRECISION_SWITCH_EPS) )
+        {
+            calibrateViews.switchToDoublePrecision();
+            solver.criteria.epsilon = solverEps;
+            jacobianUpdates = -1;
+        }
+
+        // Broyden updates replace the analytic Jacobian except every BROYDEN_FULL_JACOBIAN_PERIOD-th one,
+        // the first one in a precision and when the last step needed lambda retries
+        if( proceed && solver.state == CvLevMarq::CALC_J )
+        {
+            bool fullJ = !(flags & CALIB_USE_BROYDEN) || jacobianUpdates < 0 || errorChecks > 1 ||
+                    jacobianUpdates + 1 >= BROYDEN_FULL_JACOBIAN_PERIOD;
+            jacobianUpdates = fullJ ? 0 : jacobianUpdates + 1;
+            errorChecks = 0;
+            calibrateViews.setJacobianUpdate(!fullJ);
+            if( stats && fullJ )
+                stats->fullJacobianEvals++;
+        }
+        else
+            errorChecks++;
+
         if( flags & CALIB_FIX_ASPECT_RATIO )
         {
             param[0] = param[1]*aspectRatio;
@@ -279,88 +719,71 @@ double cvfork::cvCalibrateCamera2( const CvMat* objectPoints,
         std::copy(param + 4, param + 4 + 14, k);
 
         if( !proceed ) {
+            if( stats )
+            {
+                stats->iterations = solver.iters;
+                stats->linearIterations = pcgSolver ? pcgSolver->cgIterations : 0;
+                stats->decompositions = solver.decompositionCounters();
+            }
             //do errors estimation
-            if(JtJcopy.total() && stdDevs) {
-                Mat mask = cvarrToMat(solver.mask);
-                int nparams_nz = countNonZero(mask);
-                Mat JtJinv, JtJN;
-                JtJN.create(nparams_nz, nparams_nz, CV_64F);
-                subMatrix(JtJcopy, JtJN, mask, mask);
-                completeSymm(JtJN, false);
-#ifndef USE_LAPACK
-                cv::invert(JtJN, JtJinv, DECOMP_SVD);
-#else
-                cvfork::invert(JtJN, JtJinv, DECOMP_SVD);
-#endif
+            if( stdDevs ) {
+                int nparams_nz = countNonZero(cvarrToMat(solver.mask));
                 double sigma2 = norm(allErrors, NORM_L2SQR) / (total - nparams_nz);
-                Mat stdDevsM = cvarrToMat(stdDevs);
-                int j = 0;
-                for (int i = 0; i < nparams; i++)
-                    if(mask.data[i]) {
-                        stdDevsM.at<double>(i) = std::sqrt(JtJinv.at<double>(j,j)*sigma2);
-                        j++;
-                    }
-                    else
-                        stdDevsM.at<double>(i) = 0;
+                // the output may be single precision or not continuous
+                Mat stdDevsM = cvarrToMat(stdDevs), stdDevs64f(stdDevsM.size(), CV_64F);
+                solver.calcStdDevs(sigma2, stdDevs64f.ptr<double>(), (int)stdDevsM.total() > NINTRINSIC);
+                stdDevs64f.convertTo(stdDevsM, stdDevsM.type());
+            }
+            if( perViewLooErrors ) {
+                Mat looErrorsM = cvarrToMat(perViewLooErrors);
+                if( nimages > 1 )
+                    computeLeaveOneOutErrors(solver, viewJtJ, viewJtErr, viewErrNorms, viewOffsets,
+                                             looErrorsM.ptr<double>());
+                else
+                    looErrorsM = Scalar(0);
             }
             break;
         }
 
         reprojErr = 0;
-
-        for( i = 0, pos = 0; i < nimages; i++, pos += ni )
+        if( stats )
         {
-            CvMat _ri, _ti;
-            ni = npoints->data.i[i*npstep];
-
-            cvGetRows( solver.param, &_ri, NINTRINSIC + i*6, NINTRINSIC + i*6 + 3 );
-            cvGetRows( solver.param, &_ti, NINTRINSIC + i*6 + 3, NINTRINSIC + i*6 + 6 );
-
-            CvMat _Mi(matM.colRange(pos, pos + ni));
-            CvMat _mi(_m.colRange(pos, pos + ni));
-            CvMat _me(allErrors.colRange(pos, pos + ni));
-
-            _Je.resize(ni*2); _Ji.resize(ni*2); _err.resize(ni*2);
-            CvMat _dpdr(_Je.colRange(0, 3));
-            CvMat _dpdt(_Je.colRange(3, 6));
-            CvMat _dpdf(_Ji.colRange(0, 2));
-            CvMat _dpdc(_Ji.colRange(2, 4));
-            CvMat _dpdk(_Ji.colRange(4, NINTRINSIC));
-            CvMat _mp(_err.reshape(2, 1));
-
             if( solver.state == CvLevMarq::CALC_J )
-            {
-                 cvProjectPoints2( &_Mi, &_ri, &_ti, &matA, &_k, &_mp, &_dpdr, &_dpdt,
-                                  (flags & CALIB_FIX_FOCAL_LENGTH) ? 0 : &_dpdf,
-                                  (flags & CALIB_FIX_PRINCIPAL_POINT) ? 0 : &_dpdc, &_dpdk,
-                                  (flags & CALIB_FIX_ASPECT_RATIO) ? aspectRatio : 0);
-            }
+                stats->jacobianEvals++;
             else
-                cvProjectPoints2( &_Mi, &_ri, &_ti, &matA, &_k, &_mp );
+                stats->errorEvals++;
+        }
 
-            cvSub( &_mp, &_mi, &_mp );
+        if( flags & CALIB_USE_PARALLEL )
+            parallel_for_(Range(0, nimages), calibrateViews, getNumThreads());
+        else
+            calibrateViews(Range(0, nimages));
 
-            if( solver.state == CvLevMarq::CALC_J )
+        if( solver.state == CvLevMarq::CALC_J )
+        {
+            Mat JtJii = solver.intrinsicBlock(), JtErri = solver.intrinsicErr();
+            int nintrinsic = JtJii.rows;
+            for( i = 0; i < nimages; i++ )
             {
-                Mat JtJ(cvarrToMat(_JtJ)), JtErr(cvarrToMat(_JtErr));
-
-                // see HZ: (A6.14) for details on the structure of the Jacobian
-                JtJ(Rect(0, 0, NINTRINSIC, NINTRINSIC)) += _Ji.t() * _Ji;
-                JtJ(Rect(NINTRINSIC + i * 6, NINTRINSIC + i * 6, 6, 6)) = _Je.t() * _Je;
-                JtJ(Rect(NINTRINSIC + i * 6, 0, 6, NINTRINSIC)) = _Ji.t() * _Je;
-
-                JtErr.rowRange(0, NINTRINSIC) += _Ji.t() * _err;
-                JtErr.rowRange(NINTRINSIC + i * 6, NINTRINSIC + (i + 1) * 6) = _Je.t() * _err;
-                if (stdDevs)
-                    cvCopy(&_mp, &_me);
+                JtJii += viewJtJ(Rect(0, i*NINTRINSIC, nintrinsic, nintrinsic));
+                JtErri += viewJtErr.rowRange(i*NINTRINSIC, i*NINTRINSIC + nintrinsic);
             }
-
-            reprojErr += norm(_err, NORM_L2SQR);
         }
-        if(solver.state == CvLevMarq::CALC_J && stdDevs)
-            cvarrToMat(_JtJ).copyTo(JtJcopy);
+        for( i = 0; i < nimages; i++ )
+            reprojErr += viewErrNorms[i];
+
         if( _errNorm )
             *_errNorm = reprojErr;
+
+        // out of the time budget the optimization stops at the last accepted parameters,
+        // once their Jacobian is evaluated, so the outputs below are consistent with them
+        if( timeBudget > 0 && solver.state == CvLevMarq::CALC_J &&
+            (getTickCount() - startTick)/getTickFrequency() > timeBudget )
+        {
+            solver.state = CvLevMarq::DONE;
+            if( stats )
+                stats->converged = false;
+        }
     }
 
     // 4. store the results
@@ -437,6 +860,32 @@ static Mat prepareDistCoeffs(Mat& distCoeffs0, int rtype)
     return distCoeffs;
 }
 
+// packs poses already stored in the output array into a nimages x 3 matrix, missing views are left zero
+static Mat collectExtrinsicGuess(InputArrayOfArrays vecs, int nimages)
+{
+    Mat guess = Mat::zeros(nimages, 3, CV_64F);
+    if( vecs.isMatVector() )
+    {
+        for( int i = 0; i < std::min((int)vecs.total(), nimages); i++ )
+        {
+            Mat v = vecs.getMat(i), row = guess.row(i);
+            if( v.total()*v.channels() == 3 )
+                v.reshape(1, 1).convertTo(row, CV_64F);
+        }
+    }
+    else if( !vecs.empty() )
+    {
+        Mat v = vecs.getMat();
+        if( v.channels() == 3 )
+        {
+            int n = std::min((int)v.total(), nimages);
+            Mat rows = guess.rowRange(0, n);
+            v.reshape(1, (int)v.total()).rowRange(0, n).convertTo(rows, CV_64F);
+        }
+    }
+    return guess;
+}
+
 static void collectCalibrationData( InputArrayOfArrays objectPoints,
                                     InputArrayOfArrays imagePoints1,
                                     InputArrayOfArrays imagePoints2,
@@ -494,10 +943,13 @@ static void collectCalibrationData( InputArrayOfArrays objectPoints,
     }
 }
 
-double cvfork::calibrateCamera(InputArrayOfArrays _objectPoints,
-                            InputArrayOfArrays _imagePoints,
-                            Size imageSize, InputOutputArray _cameraMatrix, InputOutputArray _distCoeffs,
-                            OutputArrayOfArrays _rvecs, OutputArrayOfArrays _tvecs, OutputArray _stdDeviations, OutputArray _perViewErrors, int flags, TermCriteria criteria )
+// objPt is the board model when pointIds isn't empty, see calibrateCameraIndexed
+static double calibrateCameraFlat(const Mat& objPt, const Mat& pointIds, const Mat& imgPt, const Mat& npoints,
+                                  Size imageSize, InputOutputArray _cameraMatrix, InputOutputArray _distCoeffs,
+                                  OutputArrayOfArrays _rvecs, OutputArrayOfArrays _tvecs,
+                                  OutputArray _stdDeviationsIntrinsics, OutputArray _stdDeviationsExtrinsics,
+                                  OutputArray _perViewErrors, OutputArray _perViewLooErrors, int flags,
+                                  TermCriteria criteria, cvfork::SolverStats* stats, double timeBudget )
 {
     int rtype = CV_64F;
     Mat cameraMatrix = _cameraMatrix.getMat();
@@ -509,20 +961,29 @@ double cvfork::calibrateCamera(InputArrayOfArrays _objectPoints,
     (!(flags & CALIB_TILTED_MODEL)))
         distCoeffs = distCoeffs.rows == 1 ? distCoeffs.colRange(0, 5) : distCoeffs.rowRange(0, 5);
 
-    int nimages = int(_objectPoints.total());
+    int nimages = int(npoints.total());
     CV_Assert( nimages > 0 );
-    Mat objPt, imgPt, npoints, rvecM, tvecM, stdDeviationsM, errorsM;
+    Mat rvecM, tvecM, stdDeviationsM, errorsM, looErrorsM;
 
     bool rvecs_needed = _rvecs.needed(), tvecs_needed = _tvecs.needed(),
-            stddev_needed = _stdDeviations.needed(), errors_needed = _perViewErrors.needed();
+            stddev_ext_needed = _stdDeviationsExtrinsics.needed(),
+            stddev_needed = _stdDeviationsIntrinsics.needed() || stddev_ext_needed,
+            errors_needed = _perViewErrors.needed(), loo_errors_needed = _perViewLooErrors.needed();
 
     bool rvecs_mat_vec = _rvecs.isMatVector();
     bool tvecs_mat_vec = _tvecs.isMatVector();
-    bool stddev_vec = _stdDeviations.isVector();
+    bool stddev_vec = _stdDeviationsIntrinsics.isVector() || _stdDeviationsExtrinsics.isVector();
     bool errors_vec = _perViewErrors.isVector();
     CV_Assert( !stddev_vec );
     CV_Assert( !errors_vec );
 
+    Mat rvecGuess, tvecGuess;
+    if( (flags & CALIB_FORK_USE_EXTRINSIC_GUESS) && rvecs_needed && tvecs_needed )
+    {
+        rvecGuess = collectExtrinsicGuess(_rvecs, nimages);
+        tvecGuess = collectExtrinsicGuess(_tvecs, nimages);
+    }
+
     if( rvecs_needed ) {
         _rvecs.create(nimages, 1, CV_64FC3);
 
@@ -541,15 +1002,16 @@ double cvfork::calibrateCamera(InputArrayOfArrays _objectPoints,
             tvecM = _tvecs.getMat();
     }
 
-    if( stddev_needed ) {
-        _stdDeviations.create(nimages*6 + CV_CALIB_NINTRINSIC, 1, CV_64F);
-
-        if(stddev_vec)
-            stdDeviationsM.create(nimages*6 + CV_CALIB_NINTRINSIC, 1, CV_64F);
-        else
-            stdDeviationsM = _stdDeviations.getMat();
+    if( !rvecGuess.empty() )
+    {
+        rvecGuess.reshape(rvecM.channels(), nimages).copyTo(rvecM);
+        tvecGuess.reshape(tvecM.channels(), nimages).copyTo(tvecM);
     }
 
+    // per-view extrinsic deviations are computed only when they are requested
+    if( stddev_needed )
+        stdDeviationsM.create((stddev_ext_needed ? nimages*6 : 0) + CV_CALIB_NINTRINSIC, 1, CV_64F);
+
     if( errors_needed) {
         _perViewErrors.create(nimages, 1, CV_64F);
 
@@ -559,18 +1021,21 @@ double cvfork::calibrateCamera(InputArrayOfArrays _objectPoints,
             errorsM = _perViewErrors.getMat();
     }
 
-    collectCalibrationData( _objectPoints, _imagePoints, noArray(),
-                            objPt, imgPt, 0, npoints );
-    CvMat c_objPt = objPt, c_imgPt = imgPt, c_npoints = npoints;
+    if( loo_errors_needed )
+        looErrorsM.create(nimages, 1, CV_64F);
+
+    CvMat c_objPt = objPt, c_imgPt = imgPt, c_npoints = npoints, c_pointIds = pointIds;
     CvMat c_cameraMatrix = cameraMatrix, c_distCoeffs = distCoeffs;
-    CvMat c_rvecM = rvecM, c_tvecM = tvecM, c_stdDev = stdDeviationsM, c_errors = errorsM;
+    CvMat c_rvecM = rvecM, c_tvecM = tvecM, c_stdDev = stdDeviationsM, c_errors = errorsM, c_looErrors = looErrorsM;
 
     double reprojErr = cvfork::cvCalibrateCamera2(&c_objPt, &c_imgPt, &c_npoints, imageSize,
                                           &c_cameraMatrix, &c_distCoeffs,
                                           rvecs_needed ? &c_rvecM : NULL,
                                           tvecs_needed ? &c_tvecM : NULL,
                                           stddev_needed ? &c_stdDev : NULL,
-                                          errors_needed ? &c_errors : NULL, flags, criteria );
+                                          errors_needed ? &c_errors : NULL,
+                                          loo_errors_needed ? &c_looErrors : NULL, flags, criteria, stats,
+                                          timeBudget, pointIds.empty() ? NULL : &c_pointIds );
 
     // overly complicated and inefficient rvec/ tvec handling to support vector<Mat>
     for(int i = 0; i < nimages; i++ )
@@ -589,115 +1054,486 @@ double cvfork::calibrateCamera(InputArrayOfArrays _objectPoints,
         }
     }
 
+    if( loo_errors_needed )
+        looErrorsM.copyTo(_perViewLooErrors);
+    if( _stdDeviationsIntrinsics.needed() )
+        stdDeviationsM.rowRange(0, CV_CALIB_NINTRINSIC).copyTo(_stdDeviationsIntrinsics);
+    if( stddev_ext_needed )
+        stdDeviationsM.rowRange(CV_CALIB_NINTRINSIC, CV_CALIB_NINTRINSIC + nimages*6).copyTo(_stdDeviationsExtrinsics);
+
     cameraMatrix.copyTo(_cameraMatrix);
     distCoeffs.copyTo(_distCoeffs);
 
     return reprojErr;
 }
 
+double cvfork::calibrateCamera(InputArrayOfArrays _objectPoints,
+                            InputArrayOfArrays _imagePoints,
+                            Size imageSize, InputOutputArray _cameraMatrix, InputOutputArray _distCoeffs,
+                            OutputArrayOfArrays _rvecs, OutputArrayOfArrays _tvecs, OutputArray _stdDeviations,
+                            OutputArray _perViewErrors, int flags, TermCriteria criteria )
+{
+    if( !_stdDeviations.needed() )
+        return calibrateCameraExtended(_objectPoints, _imagePoints, imageSize, _cameraMatrix, _distCoeffs,
+                                       _rvecs, _tvecs, noArray(), noArray(), _perViewErrors, noArray(),
+                                       flags, criteria);
+
+    Mat stdDeviationsIntrinsics, stdDeviationsExtrinsics;
+    double reprojErr = calibrateCameraExtended(_objectPoints, _imagePoints, imageSize, _cameraMatrix, _distCoeffs,
+                                               _rvecs, _tvecs, stdDeviationsIntrinsics, stdDeviationsExtrinsics,
+                                               _perViewErrors, noArray(), flags, criteria);
+    vconcat(stdDeviationsIntrinsics, stdDeviationsExtrinsics, _stdDeviations);
+    return reprojErr;
+}
+
+double cvfork::calibrateCameraExtended(InputArrayOfArrays _objectPoints,
+                            InputArrayOfArrays _imagePoints,
+                            Size imageSize, InputOutputArray _cameraMatrix, InputOutputArray _distCoeffs,
+                            OutputArrayOfArrays _rvecs, OutputArrayOfArrays _tvecs, OutputArray _stdDeviationsIntrinsics,
+                            OutputArray _stdDeviationsExtrinsics, OutputArray _perViewErrors,
+                            OutputArray _perViewLooErrors, int flags, TermCriteria criteria,
+                            SolverStats* stats, double timeBudget )
+{
+    CV_Assert( _objectPoints.total() > 0 );
+    Mat objPt, imgPt, npoints;
+    collectCalibrationData( _objectPoints, _imagePoints, noArray(),
+                            objPt, imgPt, 0, npoints );
+    return calibrateCameraFlat(objPt, Mat(), imgPt, npoints, imageSize, _cameraMatrix, _distCoeffs,
+                               _rvecs, _tvecs, _stdDeviationsIntrinsics, _stdDeviationsExtrinsics, _perViewErrors,
+                               _perViewLooErrors, flags, criteria, stats, timeBudget);
+}
+
+double cvfork::calibrateCameraIndexed(InputArray _boardPoints, InputArray _pointIds, InputArray _imagePoints,
+                            InputArray _viewSizes, Size imageSize, InputOutputArray _cameraMatrix,
+                            InputOutputArray _distCoeffs, OutputArrayOfArrays _rvecs, OutputArrayOfArrays _tvecs,
+                            OutputArray _stdDeviationsIntrinsics, OutputArray _stdDeviationsExtrinsics,
+                            OutputArray _perViewErrors, OutputArray _perViewLooErrors, int flags,
+                            TermCriteria criteria, SolverStats* stats, double timeBudget )
+{
+    Mat boardPoints = _boardPoints.getMat(), pointIds = _pointIds.getMat();
+    Mat imagePoints = _imagePoints.getMat(), viewSizes = _viewSizes.getMat();
+    CV_Assert( boardPoints.checkVector(3, CV_32F) > 0 && viewSizes.checkVector(1, CV_32S) > 0 );
+    int total = imagePoints.checkVector(2, CV_32F);
+    CV_Assert( total > 0 && pointIds.checkVector(1, CV_32S) == total );
+
+    return calibrateCameraFlat(boardPoints, pointIds, imagePoints, viewSizes, imageSize, _cameraMatrix, _distCoeffs,
+                               _rvecs, _tvecs, _stdDeviationsIntrinsics, _stdDeviationsExtrinsics, _perViewErrors,
+                               _perViewLooErrors, flags, criteria, stats, timeBudget);
+}
+
 double cvfork::calibrateCameraCharuco(InputArrayOfArrays _charucoCorners, InputArrayOfArrays _charucoIds,
                               Ptr<aruco::CharucoBoard> &_board, Size imageSize,
                               InputOutputArray _cameraMatrix, InputOutputArray _distCoeffs,
-                              OutputArrayOfArrays _rvecs, OutputArrayOfArrays _tvecs, OutputArray _stdDeviations, OutputArray _perViewErrors,
-                              int flags, TermCriteria criteria) {
+                              OutputArrayOfArrays _rvecs, OutputArrayOfArrays _tvecs, OutputArray _stdDeviations,
+                              OutputArray _perViewErrors, int flags, TermCriteria criteria) {
+
+    if( !_stdDeviations.needed() )
+        return calibrateCameraCharucoExtended(_charucoCorners, _charucoIds, _board, imageSize, _cameraMatrix,
+                                              _distCoeffs, _rvecs, _tvecs, noArray(), noArray(), _perViewErrors,
+                                              noArray(), flags, criteria);
+
+    Mat stdDeviationsIntrinsics, stdDeviationsExtrinsics;
+    double reprojErr = calibrateCameraCharucoExtended(_charucoCorners, _charucoIds, _board, imageSize,
+                                                      _cameraMatrix, _distCoeffs, _rvecs, _tvecs,
+                                                      stdDeviationsIntrinsics, stdDeviationsExtrinsics,
+                                                      _perViewErrors, noArray(), flags, criteria);
+    vconcat(stdDeviationsIntrinsics, stdDeviationsExtrinsics, _stdDeviations);
+    return reprojErr;
+}
+
+double cvfork::calibrateCameraCharucoExtended(InputArrayOfArrays _charucoCorners, InputArrayOfArrays _charucoIds,
+                              Ptr<aruco::CharucoBoard> &_board, Size imageSize,
+                              InputOutputArray _cameraMatrix, InputOutputArray _distCoeffs,
+                              OutputArrayOfArrays _rvecs, OutputArrayOfArrays _tvecs, OutputArray _stdDeviationsIntrinsics,
+                              OutputArray _stdDeviationsExtrinsics, OutputArray _perViewErrors,
+                              OutputArray _perViewLooErrors, int flags, TermCriteria criteria, SolverStats* stats,
+                              double timeBudget) {
 
     CV_Assert(_charucoIds.total() > 0 && (_charucoIds.total() == _charucoCorners.total()));
 
-    // Join object points of charuco corners in a single vector for calibrateCamera() function
-    std::vector< std::vector< Point3f > > allObjPoints;
-    allObjPoints.resize(_charucoIds.total());
-    for(unsigned int i = 0; i < _charucoIds.total(); i++) {
-        unsigned int nCorners = (unsigned int)_charucoIds.getMat(i).total();
-        CV_Assert(nCorners > 0 && nCorners == _charucoCorners.getMat(i).total()); //actually nCorners must be > 3 for calibration
-        allObjPoints[i].reserve(nCorners);
+    // charuco corners and their ids are joined, the board model is shared by all the views
+    int nimages = (int)_charucoIds.total();
+    std::vector<int> viewSizes(nimages), pointIds;
+    std::vector<Point2f> corners;
+    for(int i = 0; i < nimages; i++) {
+        Mat ids = _charucoIds.getMat(i), viewCorners = _charucoCorners.getMat(i);
+        int nCorners = (int)ids.total();
+        CV_Assert(nCorners > 0 && nCorners == (int)viewCorners.total()); //actually nCorners must be > 3 for calibration
+        viewSizes[i] = nCorners;
+        pointIds.insert(pointIds.end(), ids.ptr<int>(), ids.ptr<int>() + nCorners);
+        corners.insert(corners.end(), viewCorners.ptr<Point2f>(), viewCorners.ptr<Point2f>() + nCorners);
+    }
+
+    return cvfork::calibrateCameraIndexed(_board->chessboardCorners, pointIds, corners, viewSizes, imageSize,
+                           _cameraMatrix, _distCoeffs, _rvecs, _tvecs, _stdDeviationsIntrinsics,
+                           _stdDeviationsExtrinsics, _perViewErrors, _perViewLooErrors, flags, criteria, stats,
+                           timeBudget);
+}
 
-        for(unsigned int j = 0; j < nCorners; j++) {
-            int pointId = _charucoIds.getMat(i).ptr< int >(0)[j];
-            CV_Assert(pointId >= 0 && pointId < (int)_board->chessboardCorners.size());
-            allObjPoints[i].push_back(_board->chessboardCorners[pointId]);
+
+void cvfork::CvLevMarqFork::step()
+{
+    using namespace cv;
+    const double LOG10 = log(10.);
+    double lambda = exp(lambdaLg10*LOG10);
+    int nparams = param->rows;
+
+    // JtJ and JtErr already hold variable parameters only, see initLayout()
+    Mat _JtJ = cvarrToMat(JtJ);
+    Mat _JtJN = cvarrToMat(JtJN);
+    Mat _JtErr = cvarrToMat(JtErr);
+    Mat_<double> nonzero_param = cvarrToMat(JtJW);
+
+    // the factor of the first step of a Jacobian is kept for its retries, which only increase lambda
+    bool solved = false;
+    if( reuseFactorization )
+    {
+        if( factorized && lambda != factorLambda )
+            solved = solveFactorized(lambda, nonzero_param);
+        if( !solved && factorize(lambda) )
+        {
+            scaledErr.copyTo(nonzero_param);
+            choleskyBackSubst(_JtJN.ptr<double>(), _JtJN.step, _JtJN.rows, nonzero_param.ptr<double>(),
+                              sizeof(double), 1);
+            multiply(nonzero_param, jacobiScale, nonzero_param);
+            solved = true;
         }
     }
+    if( !solved )
+    {
+        _JtJ.copyTo(_JtJN);
+        if( !err )
+            completeSymm( _JtJN, completeSymmFlag );
+#if 1
+        _JtJN.diag() *= 1. + lambda;
+#else
+        _JtJN.diag() += lambda;
+#endif
+        // _JtJN is a scratch copy, so it's factored in place
+        linearSolver.solve(_JtJN, _JtErr, nonzero_param, solveMethod);
+    }
 
-    return cvfork::calibrateCamera(allObjPoints, _charucoCorners, imageSize, _cameraMatrix, _distCoeffs,
-                           _rvecs, _tvecs, _stdDeviations, _perViewErrors, flags, criteria);
+    int j = 0;
+    for( int i = 0; i < nparams; i++ )
+        param->data.db[i] = prevParam->data.db[i] - (mask->data.ptr[i] ? nonzero_param(j++) : 0);
 }
 
+cvfork::CvLevMarqFork::CvLevMarqFork(int nparams, int nerrs, CvTermCriteria criteria0, bool _completeSymmFlag) :
+    reuseFactorization(false), viewsOffset(CV_CALIB_NINTRINSIC), factorized(false), factorLambda(0)
+{
+    initState(nparams, criteria0, _completeSymmFlag);
+    JtJ.reset(cvCreateMat( nparams, nparams, CV_64F ));
+    JtErr.reset(cvCreateMat( nparams, 1, CV_64F ));
+    if( nerrs > 0 )
+    {
+        J.reset(cvCreateMat( nerrs, nparams, CV_64F ));
+        err.reset(cvCreateMat( nerrs, 1, CV_64F ));
+    }
+}
+
+cvfork::CvLevMarqFork::CvLevMarqFork() :
+    reuseFactorization(false), viewsOffset(CV_CALIB_NINTRINSIC), factorized(false), factorLambda(0)
+{
+}
+
+void cvfork::CvLevMarqFork::initState(int nparams, CvTermCriteria criteria0, bool _completeSymmFlag)
+{
+    mask.reset(cvCreateMat( nparams, 1, CV_8U ));
+    cvSet(mask, cvScalarAll(1));
+    prevParam.reset(cvCreateMat( nparams, 1, CV_64F ));
+    param.reset(cvCreateMat( nparams, 1, CV_64F ));
+
+    errNorm = prevErrNorm = DBL_MAX;
+    lambdaLg10 = -3;
+    criteria = criteria0;
+    if( criteria.type & CV_TERMCRIT_ITER )
+        criteria.max_iter = MIN(MAX(criteria.max_iter,1),1000);
+    else
+        criteria.max_iter = 30;
+    if( criteria.type & CV_TERMCRIT_EPS )
+        criteria.epsilon = MAX(criteria.epsilon, 0);
+    else
+        criteria.epsilon = DBL_EPSILON;
+    state = STARTED;
+    iters = 0;
+    completeSymmFlag = _completeSymmFlag;
+    solveMethod = DECOMP_CHOLESKY;
+}
 
-static void subMatrix(const cv::Mat& src, cv::Mat& dst, const std::vector<uchar>& cols,
-                      const std::vector<uchar>& rows) {
-    int nonzeros_cols = cv::countNonZero(cols);
-    cv::Mat tmp(src.rows, nonzeros_cols, CV_64FC1);
+cvfork::CvLevMarqFork::~CvLevMarqFork()
+{
+    clear();
+}
+
+void cvfork::CvLevMarqFork::clearNormalEquations()
+{
+    cvZero( JtJ );
+    cvZero( JtErr );
+}
 
-    for (int i = 0, j = 0; i < (int)cols.size(); i++)
+void cvfork::CvLevMarqFork::buildIntrinsicIndex()
+{
+    const uchar* _mask = mask->data.ptr;
+    intrinsicIdx.clear();
+    for( int k = 0; k < CV_CALIB_NINTRINSIC; k++ )
+        if( _mask[k] )
+            intrinsicIdx.push_back(k);
+    // extrinsics are never fixed, so view blocks keep their layout
+    for( int k = CV_CALIB_NINTRINSIC; k < param->rows; k++ )
+        CV_Assert( _mask[k] );
+}
+
+void cvfork::CvLevMarqFork::initLayout()
+{
+    buildIntrinsicIndex();
+    viewsOffset = (int)intrinsicIdx.size();
+    int nparams_nz = viewsOffset + param->rows - CV_CALIB_NINTRINSIC;
+
+    if( !JtJN || JtJN->rows != nparams_nz )
     {
-        if (cols[i])
+        JtJ.reset(cvCreateMat( nparams_nz, nparams_nz, CV_64F ));
+        JtErr.reset(cvCreateMat( nparams_nz, 1, CV_64F ));
+        JtJN.reset(cvCreateMat( nparams_nz, nparams_nz, CV_64F ));
+        JtJW.reset(cvCreateMat( nparams_nz, 1, CV_64F ));
+    }
+}
+
+bool cvfork::CvLevMarqFork::factorize( double lambda )
+{
+    Mat _JtJN = cvarrToMat(JtJN), _JtErr = cvarrToMat(JtErr);
+    int n = _JtJN.rows;
+
+    if( !factorized )
+    {
+        cvarrToMat(JtJ).copyTo(scaledJtJ);
+        completeSymm( scaledJtJ, completeSymmFlag );
+
+        // the damping scales the diagonal, so it becomes lambda*I after the scaling
+        jacobiScale.create(n, 1, CV_64F);
+        double* s = jacobiScale.ptr<double>();
+        for( int i = 0; i < n; i++ )
         {
-            src.col(i).copyTo(tmp.col(j++));
+            double d = scaledJtJ.at<double>(i, i);
+            s[i] = d > DBL_EPSILON ? 1./std::sqrt(d) : 1.;
         }
+        for( int i = 0; i < n; i++ )
+        {
+            double* row = scaledJtJ.ptr<double>(i);
+            for( int j = 0; j < n; j++ )
+                row[j] *= s[i]*s[j];
+        }
+        multiply(_JtErr, jacobiScale, scaledErr);
     }
 
-    int nonzeros_rows  = cv::countNonZero(rows);
-    dst.create(nonzeros_rows, nonzeros_cols, CV_64FC1);
-    for (int i = 0, j = 0; i < (int)rows.size(); i++)
+    scaledJtJ.copyTo(_JtJN);
+    _JtJN.diag() *= 1. + lambda;
+    factorized = choleskySolve(_JtJN.ptr<double>(), _JtJN.step, n, 0, 0, 0);
+    factorLambda = lambda;
+    factorCounters.cholesky++;
+    return factorized;
+}
+
+bool cvfork::CvLevMarqFork::solveFactorized( double lambda, Mat& delta )
+{
+    // a CG iteration is a product with the n x n matrix and a back substitution, about 4*n^2 flops,
+    // so it's stopped once it would cost as much as the n^3/3 of a new factorization
+    const double CG_EPS = 1e-6;
+    int n = scaledJtJ.rows, maxIters = std::max(n/12, 4);
+    const double* L = cvarrToMat(JtJN).ptr<double>();
+    size_t lstep = JtJN->step;
+
+    cgBuf.create(4, n, CV_64F);
+    double *x = cgBuf.ptr<double>(0), *r = cgBuf.ptr<double>(1), *z = cgBuf.ptr<double>(2),
+            *p = cgBuf.ptr<double>(3);
+    const double* g = scaledErr.ptr<double>();
+
+    // M = A + factorLambda*diag(A), so M^-1*g is a close start and its residual is cheap:
+    // g - (A + lambda*diag(A))*x = (factorLambda - lambda)*diag(A)*x
+    std::copy(g, g + n, x);
+    choleskyBackSubst(L, lstep, n, x, sizeof(double), 1);
+    double gnorm = 0, rnorm = 0;
+    for( int i = 0; i < n; i++ )
     {
-        if (rows[i])
+        r[i] = (factorLambda - lambda)*scaledJtJ.at<double>(i, i)*x[i];
+        gnorm += g[i]*g[i];
+        rnorm += r[i]*r[i];
+    }
+
+    double rz = 0;
+    for( int it = 0; rnorm > CG_EPS*CG_EPS*gnorm; it++ )
+    {
+        if( it == maxIters )
+            return false;
+        std::copy(r, r + n, z);
+        choleskyBackSubst(L, lstep, n, z, sizeof(double), 1);
+        double rzPrev = rz;
+        rz = 0;
+        for( int i = 0; i < n; i++ )
+            rz += r[i]*z[i];
+        for( int i = 0; i < n; i++ )
+            p[i] = it == 0 ? z[i] : z[i] + rz/rzPrev*p[i];
+
+        // z is free until the next preconditioning, so it holds q = (A + lambda*diag(A))*p
+        double pq = 0;
+        for( int i = 0; i < n; i++ )
         {
-            tmp.row(i).copyTo(dst.row(j++));
+            const double* row = scaledJtJ.ptr<double>(i);
+            double q = lambda*row[i]*p[i];
+            for( int j = 0; j < n; j++ )
+                q += row[j]*p[j];
+            z[i] = q;
+            pq += p[i]*q;
+        }
+        if( pq <= 0 )
+            return false;
+        double alpha = rz/pq;
+        rnorm = 0;
+        for( int i = 0; i < n; i++ )
+        {
+            x[i] += alpha*p[i];
+            r[i] -= alpha*z[i];
+            rnorm += r[i]*r[i];
         }
     }
+
+    double* d = delta.ptr<double>();
+    const double* s = jacobiScale.ptr<double>();
+    for( int i = 0; i < n; i++ )
+        d[i] = x[i]*s[i];
+    factorCounters.reused++;
+    return true;
 }
 
-void cvfork::CvLevMarqFork::step()
+// inverts the symmetric reduced camera system: Cholesky of the Jacobi-scaled matrix, or
+// pseudo-inverse when it isn't positive definite or is too ill-conditioned for the factor
+static void invertReducedSystem( const Matx<double, CV_CALIB_NINTRINSIC, CV_CALIB_NINTRINSIC>& S,
+                                 Matx<double, CV_CALIB_NINTRINSIC, CV_CALIB_NINTRINSIC>& Sinv )
 {
-    using namespace cv;
-    const double LOG10 = log(10.);
-    double lambda = exp(lambdaLg10*LOG10);
-    int nparams = param->rows;
+    const int N = CV_CALIB_NINTRINSIC;
+    const double maxCondition = 1e12;
+    Matx<double, N, N> Sn, L;
+    double scale[N];
+
+    for( int i = 0; i < N; i++ )
+        scale[i] = S(i, i) > DBL_EPSILON ? 1./std::sqrt(S(i, i)) : 1.;
+    for( int i = 0; i < N; i++ )
+        for( int j = 0; j < N; j++ )
+            Sn(i, j) = S(i, j)*scale[i]*scale[j];
+
+    L = Sn;
+    Sinv = Matx<double, N, N>::eye();
+    bool ok = cvfork::choleskySolve(L.val, N*sizeof(double), N, Sinv.val, N*sizeof(double), N);
+    if( ok )
+    {
+        // the factor diagonal is stored inverted, cond(Sn) ~ (max l_ii/min l_ii)^2
+        double minDiag = DBL_MAX, maxDiag = 0;
+        for( int i = 0; i < N; i++ )
+        {
+            minDiag = std::min(minDiag, 1./L(i, i));
+            maxDiag = std::max(maxDiag, 1./L(i, i));
+        }
+        ok = maxDiag*maxDiag < maxCondition*minDiag*minDiag;
+    }
+    if( !ok )
+        cv::invert(Sn, Sinv, DECOMP_SVD);
 
-    Mat _JtJ = cvarrToMat(JtJ);
-    Mat _mask = cvarrToMat(mask);
+    for( int i = 0; i < N; i++ )
+        for( int j = 0; j < N; j++ )
+            Sinv(i, j) *= scale[i]*scale[j];
+}
 
-    int nparams_nz = countNonZero(_mask);
-    if(!JtJN || JtJN->rows != nparams_nz) {
-        // prevent re-allocation in every step
-        JtJN.reset(cvCreateMat( nparams_nz, nparams_nz, CV_64F ));
-        JtJV.reset(cvCreateMat( nparams_nz, 1, CV_64F ));
-        JtJW.reset(cvCreateMat( nparams_nz, 1, CV_64F ));
+void cvfork::CvLevMarqFork::calcStdDevs( double sigma2, double* stdDevs, bool withExtrinsics )
+{
+    const int N = CV_CALIB_NINTRINSIC;
+    typedef Matx<double, N, 6> MatxIE;
+    int nintrinsic = (int)intrinsicIdx.size(), nviews = (param->rows - N)/6;
+
+    // reduced camera system S = U - sum W*V^-1*W^t, fixed intrinsics are padded with identity
+    Matx<double, N, N> S, Sinv;
+    Mat U = intrinsicBlock();
+    for( int i = 0; i < nintrinsic; i++ )
+        for( int j = 0; j < nintrinsic; j++ )
+            S(i, j) = U.at<double>(i, j);
+    for( int i = nintrinsic; i < N; i++ )
+        S(i, i) = 1;
+
+    // rows of W above nintrinsic stay zero
+    Matx66d V, Vinv;
+    MatxIE W, Y;
+    auto loadView = [&]( int v )
+    {
+        Mat Vm = viewBlock(v), Wm = couplingBlock(v);
+        for( int i = 0; i < 6; i++ )
+            for( int j = 0; j < 6; j++ )
+                V(i, j) = Vm.at<double>(i, j);
+        for( int i = 0; i < nintrinsic; i++ )
+            for( int j = 0; j < 6; j++ )
+                W(i, j) = Wm.at<double>(i, j);
+        invertViewBlock(V.val, 1., Vinv);
+    };
+    for( int v = 0; v < nviews; v++ )
+    {
+        loadView(v);
+        S -= W*Vinv*W.t();
     }
+    invertReducedSystem(S, Sinv);
 
-    Mat _JtJN = cvarrToMat(JtJN);
-    Mat _JtErr = cvarrToMat(JtJV);
-    Mat_<double> nonzero_param = cvarrToMat(JtJW);
+    std::fill(stdDevs, stdDevs + N, 0.);
+    for( int k = 0; k < nintrinsic; k++ )
+        stdDevs[intrinsicIdx[k]] = std::sqrt(Sinv(k, k)*sigma2);
 
-    subMatrix(cvarrToMat(JtErr), _JtErr, std::vector<uchar>(1, 1), _mask);
-    subMatrix(_JtJ, _JtJN, _mask, _mask);
+    if( !withExtrinsics )
+        return;
 
-    if( !err )
-        completeSymm( _JtJN, completeSymmFlag );
-#if 1
-    _JtJN.diag() *= 1. + lambda;
-#else
-    _JtJN.diag() += lambda;
-#endif
-#ifndef USE_LAPACK
-    cv::solve(_JtJN, _JtErr, nonzero_param, solveMethod);
-#else
-    cvfork::solve(_JtJN, _JtErr, nonzero_param, solveMethod);
-#endif
+    // covariance of view extrinsics is V^-1 + V^-1*W^t*Sinv*W*V^-1
+    for( int v = 0; v < nviews; v++ )
+    {
+        loadView(v);
+        Y = W*Vinv;
+        Matx66d C = Vinv + Y.t()*Sinv*Y;
+        for( int k = 0; k < 6; k++ )
+            stdDevs[N + v*6 + k] = std::sqrt(C(k, k)*sigma2);
+    }
+}
 
-    int j = 0;
-    for( int i = 0; i < nparams; i++ )
-        param->data.db[i] = prevParam->data.db[i] - (mask->data.ptr[i] ? nonzero_param(j++) : 0);
+const std::vector<int>& cvfork::CvLevMarqFork::intrinsicIndex() const
+{
+    return intrinsicIdx;
 }
 
-cvfork::CvLevMarqFork::CvLevMarqFork(int nparams, int nerrs, CvTermCriteria criteria0, bool _completeSymmFlag)
+Mat cvfork::CvLevMarqFork::intrinsicBlock()
 {
-    init(nparams, nerrs, criteria0, _completeSymmFlag);
+    return cvarrToMat(JtJ)(Rect(0, 0, viewsOffset, viewsOffset));
 }
 
-cvfork::CvLevMarqFork::~CvLevMarqFork()
+Mat cvfork::CvLevMarqFork::viewBlock(int view)
 {
-    clear();
+    int ofs = viewsOffset + view*6;
+    return cvarrToMat(JtJ)(Rect(ofs, ofs, 6, 6));
+}
+
+Mat cvfork::CvLevMarqFork::couplingBlock(int view)
+{
+    return cvarrToMat(JtJ)(Rect(viewsOffset + view*6, 0, 6, viewsOffset));
+}
+
+cvfork::DecompCounters cvfork::CvLevMarqFork::decompositionCounters() const
+{
+    DecompCounters counters = linearSolver.counters();
+    counters.cholesky += factorCounters.cholesky;
+    counters.reused += factorCounters.reused;
+    return counters;
+}
+
+Mat cvfork::CvLevMarqFork::intrinsicErr()
+{
+    return cvarrToMat(JtErr).rowRange(0, (int)intrinsicIdx.size());
+}
+
+Mat cvfork::CvLevMarqFork::viewErr(int view)
+{
+    int ofs = viewsOffset + view*6;
+    return cvarrToMat(JtErr).rowRange(ofs, ofs + 6);
 }
 
 bool cvfork::CvLevMarqFork::updateAlt( const CvMat*& _param, CvMat*& _JtJ, CvMat*& _JtErr, double*& _errNorm )
@@ -712,8 +1548,8 @@ bool cvfork::CvLevMarqFork::updateAlt( const CvMat*& _param, CvMat*& _JtJ, CvMat
     if( state == STARTED )
     {
         _param = param;
-        cvZero( JtJ );
-        cvZero( JtErr );
+        initLayout();
+        clearNormalEquations();
         errNorm = 0;
         _JtJ = JtJ;
         _JtErr = JtErr;
@@ -725,6 +1561,7 @@ bool cvfork::CvLevMarqFork::updateAlt( const CvMat*& _param, CvMat*& _JtJ, CvMat
     if( state == CALC_J )
     {
         cvCopy( param, prevParam );
+        factorized = false;
         step();
         _param = param;
         prevErrNorm = errNorm;
@@ -759,8 +1596,7 @@ bool cvfork::CvLevMarqFork::updateAlt( const CvMat*& _param, CvMat*& _JtJ, CvMat
     }
 
     prevErrNorm = errNorm;
-    cvZero( JtJ );
-    cvZero( JtErr );
+    clearNormalEquations();
     _param = param;
     _JtJ = JtJ;
     _JtErr = JtErr;
@@ -0,0 +1,163 @@
+#include "distortionInit.hpp"
+#include <opencv2/calib3d.hpp>
+#include <algorithm>
+#include <cmath>
+
+using namespace cv;
+
+// number of radii the division model is sampled at when it's converted to the Brown model
+static const int BROWN_FIT_SAMPLES = 32;
+
+// first two rows of the view homography (up to scale) from x*(h2.p) - y*(h1.p) = 0,
+// image points are relative to the distortion center, so radial distortion doesn't change the constraint
+static bool estimateRadialRows(const Point3d* M, const Point2d* m, int n, const Point2d& center,
+                               double imgScale, const Vec3d& boardMean, double boardScale, Vec<double, 6>& h)
+{
+    Matx66d AtA = Matx66d::zeros();
+    for( int j = 0; j < n; j++ )
+    {
+        double x = (m[j].x - center.x)*imgScale, y = (m[j].y - center.y)*imgScale;
+        double p[] = { (M[j].x - boardMean[0])*boardScale, (M[j].y - boardMean[1])*boardScale, 1. };
+        double row[] = { -y*p[0], -y*p[1], -y*p[2], x*p[0], x*p[1], x*p[2] };
+        for( int a = 0; a < 6; a++ )
+            for( int b = a; b < 6; b++ )
+                AtA(a, b) += row[a]*row[b];
+    }
+    for( int a = 0; a < 6; a++ )
+        for( int b = 0; b < a; b++ )
+            AtA(a, b) = AtA(b, a);
+
+    Mat w, v;
+    eigen(AtA, w, v);
+    // the solution is a one-dimensional null space, a planar target seen head-on gives more
+    if( w.at<double>(4) <= std::max(w.at<double>(0), DBL_MIN)*1e-10 )
+        return false;
+    for( int a = 0; a < 6; a++ )
+        h[a] = v.at<double>(5, a);
+    return true;
+}
+
+bool cvfork::initIntrinsicParamsDivisionModel(const Mat& objPoints, const Mat& imgPoints,
+                                              const std::vector<int>& viewOffsets, Size imageSize,
+                                              double aspectRatio, int flags, Matx33d& A, double* k)
+{
+    CV_Assert( objPoints.type() == CV_64FC3 && imgPoints.type() == CV_64FC2 );
+    if( flags & CALIB_FIX_K1 )
+        return false;
+
+    int nimages = (int)viewOffsets.size() - 1, total = viewOffsets.back();
+    const Point3d* M = objPoints.ptr<Point3d>();
+    const Point2d* m = imgPoints.ptr<Point2d>();
+    Point2d center(A(0, 2), A(1, 2));
+    double imgScale = 2./(imageSize.width + imageSize.height);
+
+    // lambda is shared by all views: the third homography rows are eliminated view by view,
+    // S*lambda = r is what remains of the normal equations
+    double S = 0, r = 0, maxR2 = 0;
+    int nviews = 0;
+    for( int i = 0; i < nimages; i++ )
+    {
+        int pos = viewOffsets[i], n = viewOffsets[i + 1] - pos;
+        if( n < 6 )
+            continue;
+
+        Vec3d boardMean;
+        for( int j = 0; j < n; j++ )
+            boardMean += Vec3d(M[pos + j].x, M[pos + j].y, 0.);
+        boardMean *= 1./n;
+        double boardSpread = 0;
+        for( int j = 0; j < n; j++ )
+            boardSpread += std::abs(M[pos + j].x - boardMean[0]) + std::abs(M[pos + j].y - boardMean[1]);
+        if( boardSpread <= 0 )
+            continue;
+        double boardScale = 2.*n/boardSpread;
+
+        Vec<double, 6> h;
+        if( !estimateRadialRows(M + pos, m + pos, n, center, imgScale, boardMean, boardScale, h) )
+            continue;
+
+        // (h1.p)*r^2*lambda - x*(h3.p) = -(h1.p), the same for y and h2
+        Matx44d AtA = Matx44d::zeros();
+        Vec4d Atb;
+        for( int j = 0; j < n; j++ )
+        {
+            double x = (m[pos + j].x - center.x)*imgScale, y = (m[pos + j].y - center.y)*imgScale;
+            double r2 = x*x + y*y;
+            double p[] = { (M[pos + j].x - boardMean[0])*boardScale, (M[pos + j].y - boardMean[1])*boardScale, 1. };
+            double u = h[0]*p[0] + h[1]*p[1] + h[2], v = h[3]*p[0] + h[4]*p[1] + h[5];
+            double rows[2][4] = { { -x*p[0], -x*p[1], -x, u*r2 }, { -y*p[0], -y*p[1], -y, v*r2 } };
+            double rhs[] = { -u, -v };
+            for( int e = 0; e < 2; e++ )
+                for( int a = 0; a < 4; a++ )
+                {
+                    for( int b = 0; b < 4; b++ )
+                        AtA(a, b) += rows[e][a]*rows[e][b];
+                    Atb[a] += rows[e][a]*rhs[e];
+                }
+            maxR2 = std::max(maxR2, r2);
+        }
+
+        Matx33d H = AtA.get_minor<3, 3>(0, 0);
+        Vec3d Hl(AtA(0, 3), AtA(1, 3), AtA(2, 3)), Hb(Atb[0], Atb[1], Atb[2]);
+        Matx33d Hinv;
+        if( invert(H, Hinv, DECOMP_CHOLESKY) == 0 )
+            continue;
+        S += AtA(3, 3) - Hl.dot(Hinv*Hl);
+        r += Atb[3] - Hl.dot(Hinv*Hb);
+        nviews++;
+    }
+
+    if( nviews == 0 || S <= DBL_EPSILON*std::abs(r) )
+        return false;
+    double lambda = r/S;
+    // the model must stay positive and monotonic over the observed radii
+    if( 1. + lambda*maxR2 <= 0.1 || lambda*maxR2 >= 0.9 )
+        return false;
+
+    Mat undistorted(1, total, CV_64FC2);
+    Point2d* mu = undistorted.ptr<Point2d>();
+    double maxDistortedR2 = 0;
+    for( int j = 0; j < total; j++ )
+    {
+        Point2d d = (m[j] - center)*imgScale;
+        double r2 = d.dot(d);
+        mu[j] = center + (m[j] - center)*(1./(1. + lambda*r2));
+        maxDistortedR2 = std::max(maxDistortedR2, r2);
+    }
+
+    Mat npoints(1, nimages, CV_32S);
+    for( int i = 0; i < nimages; i++ )
+        npoints.at<int>(i) = viewOffsets[i + 1] - viewOffsets[i];
+    Matx33d Au;
+    CvMat _M(objPoints), _m(undistorted), _npoints(npoints), _A = cvMat(3, 3, CV_64F, Au.val);
+    cvInitIntrinsicParams2D( &_M, &_m, &_npoints, cvSize(imageSize.width, imageSize.height), &_A, aspectRatio );
+    if( !(Au(0, 0) > 0 && Au(1, 1) > 0) )
+        return false;
+
+    // in normalized camera coordinates r_u = r_d/(1 + lambdaN*r_d^2), the Brown model is
+    // r_d = r_u*(1 + k1*r_u^2 + k2*r_u^4), so k1*r_u^2 + k2*r_u^4 = lambdaN*r_d^2 is fitted over
+    // the observed range of radii
+    double f = std::sqrt(Au(0, 0)*Au(1, 1))*imgScale;
+    double lambdaN = lambda*f*f, maxRd = std::sqrt(maxDistortedR2)/f;
+    bool fitK2 = !(flags & CALIB_FIX_K2);
+    Matx22d AtA = Matx22d::zeros();
+    Vec2d Atb;
+    for( int s = 1; s <= BROWN_FIT_SAMPLES; s++ )
+    {
+        double rd = maxRd*s/BROWN_FIT_SAMPLES, rd2 = rd*rd;
+        double ru = rd/(1. + lambdaN*rd2), ru2 = ru*ru;
+        Vec2d row(ru2, fitK2 ? ru2*ru2 : 0.);
+        AtA += row*row.t();
+        Atb += row*(lambdaN*rd2);
+    }
+    if( !fitK2 )
+        AtA(1, 1) = 1.;
+    Vec2d kb;
+    if( !solve(AtA, Atb, kb, DECOMP_CHOLESKY) )
+        return false;
+
+    A = Au;
+    k[0] = kb[0];
+    k[1] = kb[1];
+    return true;
+}
@@ -0,0 +1,164 @@
+#include "doglegSolver.hpp"
+
+using namespace cv;
+
+cvfork::CvDoglegFork::CvDoglegFork( int nparams, CvTermCriteria criteria0 ) :
+    CvLevMarqFork(nparams, 0, criteria0), radius(0), predictedReduction(0), stepNorm(0), paramNorm(0)
+{
+}
+
+cvfork::CvDoglegFork::~CvDoglegFork()
+{
+}
+
+void cvfork::CvDoglegFork::computeSteps()
+{
+    Mat _JtErr = cvarrToMat(JtErr), _JtJN = cvarrToMat(JtJN);
+    int n = _JtErr.rows;
+
+    cvarrToMat(JtJ).copyTo(scaledJtJ);
+    completeSymm( scaledJtJ, completeSymmFlag );
+
+    jacobiScale.create(n, 1, CV_64F);
+    double* s = jacobiScale.ptr<double>();
+    for( int i = 0; i < n; i++ )
+    {
+        double d = scaledJtJ.at<double>(i, i);
+        s[i] = d > DBL_EPSILON ? 1./std::sqrt(d) : 1.;
+    }
+    for( int i = 0; i < n; i++ )
+    {
+        double* row = scaledJtJ.ptr<double>(i);
+        for( int j = 0; j < n; j++ )
+            row[j] *= s[i]*s[j];
+    }
+    multiply(_JtErr, jacobiScale, scaledErr);
+
+    // the parameters are updated as param = prevParam - D^-1*h, so both steps go along +g
+    scaledJtJ.copyTo(_JtJN);
+    linearSolver.solve(_JtJN, scaledErr, gaussNewtonStep, solveMethod);
+
+    double gg = scaledErr.dot(scaledErr);
+    double gBg = scaledErr.dot(scaledJtJ*scaledErr);
+    multiply(scaledErr, gBg > DBL_EPSILON ? gg/gBg : 0., cauchyStep);
+
+    paramNorm = 0;
+    const double* _param = param->data.db;
+    const uchar* _mask = mask->data.ptr;
+    for( int i = 0, j = 0; i < param->rows; i++ )
+        if( _mask[i] )
+        {
+            double x = _param[i]/s[j++];
+            paramNorm += x*x;
+        }
+    paramNorm = std::sqrt(paramNorm);
+}
+
+void cvfork::CvDoglegFork::step()
+{
+    Mat_<double> nonzero_param = cvarrToMat(JtJW);
+    double gnNorm = norm(gaussNewtonStep), cpNorm = norm(cauchyStep);
+    Mat h = nonzero_param;
+
+    if( gnNorm <= radius )
+        gaussNewtonStep.copyTo(h);
+    else if( cpNorm >= radius )
+        multiply(cauchyStep, cpNorm > 0 ? radius/cpNorm : 0., h);
+    else
+    {
+        // intersection of the segment from the Cauchy point to the Gauss-Newton point with the boundary
+        Mat d = gaussNewtonStep - cauchyStep;
+        double a = d.dot(d), b = 2*cauchyStep.dot(d), c = cpNorm*cpNorm - radius*radius;
+        double beta = (-b + std::sqrt(std::max(b*b - 4*a*c, 0.)))/(2*a);
+        addWeighted(cauchyStep, 1., d, beta, 0., h);
+    }
+
+    // reduction of the squared error norm predicted by the linear model
+    stepNorm = norm(h);
+    predictedReduction = 2*scaledErr.dot(h) - h.dot(scaledJtJ*h);
+
+    multiply(h, jacobiScale, nonzero_param);
+    int j = 0;
+    for( int i = 0; i < param->rows; i++ )
+        param->data.db[i] = prevParam->data.db[i] - (mask->data.ptr[i] ? nonzero_param(j++) : 0);
+}
+
+bool cvfork::CvDoglegFork::updateAlt( const CvMat*& _param, CvMat*& _JtJ, CvMat*& _JtErr, double*& _errNorm )
+{
+    CV_Assert( !err );
+    if( state == DONE )
+    {
+        _param = param;
+        return false;
+    }
+
+    if( state == STARTED )
+    {
+        _param = param;
+        initLayout();
+        clearNormalEquations();
+        radius = 0;
+        errNorm = 0;
+        _JtJ = JtJ;
+        _JtErr = JtErr;
+        _errNorm = &errNorm;
+        state = CALC_J;
+        return true;
+    }
+
+    if( state == CALC_J )
+    {
+        cvCopy( param, prevParam );
+        computeSteps();
+        // the first step is a plain Gauss-Newton one
+        if( radius <= 0 )
+            radius = std::max(norm(gaussNewtonStep), DBL_EPSILON);
+        step();
+        _param = param;
+        prevErrNorm = errNorm;
+        errNorm = 0;
+        _errNorm = &errNorm;
+        state = CHECK_ERR;
+        return true;
+    }
+
+    assert( state == CHECK_ERR );
+    double rho = predictedReduction > 0 ? (prevErrNorm - errNorm)/predictedReduction : -1;
+    if( rho > 0.75 )
+        radius = std::max(radius, 3*stepNorm);
+    else if( rho < 0.25 )
+        radius = 0.5*std::min(radius, stepNorm);
+
+    bool tooSmall = radius <= criteria.epsilon*(paramNorm + criteria.epsilon);
+    if( rho <= 0 )
+    {
+        if( !tooSmall )
+        {
+            step();
+            _param = param;
+            errNorm = 0;
+            _errNorm = &errNorm;
+            state = CHECK_ERR;
+            return true;
+        }
+        // no acceptable step left, stay at the last point
+        cvCopy( prevParam, param );
+        errNorm = prevErrNorm;
+    }
+
+    if( ++iters >= criteria.max_iter || tooSmall ||
+        cvNorm(param, prevParam, CV_RELATIVE_L2) < criteria.epsilon )
+    {
+        _param = param;
+        state = DONE;
+        return false;
+    }
+
+    prevErrNorm = errNorm;
+    clearNormalEquations();
+    _param = param;
+    _JtJ = JtJ;
+    _JtErr = JtErr;
+    state = CALC_J;
+    return true;
+}
@@ -136,7 +136,7 @@ bool CalibProcessor::detectAndParseDualACircles(const cv::Mat &frame)
     return true;
 }
 
-void CalibProcessor::saveFrameData()
+void CalibProcessor::initBoardModel()
 {
     std::vector<cv::Point3f> objectPoints;
 
@@ -147,20 +147,15 @@ void CalibProcessor::saveFrameData()
         for( int i = 0; i < mBoardSize.height; ++i )
             for( int j = 0; j < mBoardSize.width; ++j )
                 objectPoints.push_back(cv::Point3f(j*mSquareSize, i*mSquareSize, 0));
-        mCalibData->imagePoints.push_back(mCurrentImagePoints);
-        mCalibData->objectPoints.push_back(objectPoints);
         break;
     case TemplateType::chAruco:
-        mCalibData->allCharucoCorners.push_back(mCurrentCharucoCorners);
-        mCalibData->allCharucoIds.push_back(mCurrentCharucoIds);
+        objectPoints = mCharucoBoard->chessboardCorners;
         break;
     case TemplateType::AcirclesGrid:
         objectPoints.reserve(mBoardSize.height*mBoardSize.width);
         for( int i = 0; i < mBoardSize.height; i++ )
             for( int j = 0; j < mBoardSize.width; j++ )
                 objectPoints.push_back(cv::Point3f((2*j + i % 2)*mSquareSize, i*mSquareSize, 0));
-        mCalibData->imagePoints.push_back(mCurrentImagePoints);
-        mCalibData->objectPoints.push_back(objectPoints);
         break;
     case TemplateType::DoubleAcirclesGrid:
     {
@@ -181,12 +176,22 @@ void CalibProcessor::saveFrameData()
             for( int j = 0; j < mBoardSize.width; j++ )
                 objectPoints.push_back(cv::Point3f(-float((2*j + i % 2)*mSquareSize - gridCenterX),
                                           -float(i*mSquareSize) - gridCenterY, 0));
-
-        mCalibData->imagePoints.push_back(mCurrentImagePoints);
-        mCalibData->objectPoints.push_back(objectPoints);
     }
         break;
     }
+
+    mCalibData->observations.setBoardModel(objectPoints);
+}
+
+void CalibProcessor::saveFrameData()
+{
+    observationStore& observations = mCalibData->observations;
+    if(mBoardType == TemplateType::chAruco)
+        observations.addView(mCurrentCharucoCorners.reshape(2, 1), mCurrentCharucoIds.reshape(1, 1));
+    else
+        observations.addView(mCurrentImagePoints);
+    mCalibData->coverage.addFrame(observations.viewPoints(observations.viewsCount() - 1));
+    mCalibData->poses.addView(mCurrentPoseBin);
 }
 
 void CalibProcessor::showCaptureMessage(const cv::Mat& frame, const std::string &message)
@@ -203,7 +208,6 @@ bool CalibProcessor::checkLastFrame()
 {
     bool isFrameBad = false;
     cv::Mat tmpCamMatrix;
-    const double badAngleThresh = 40;
 
     if(!mCalibData->cameraMatrix.total()) {
         tmpCamMatrix = cv::Mat::eye(3, 3, CV_64F);
@@ -215,35 +219,35 @@ bool CalibProcessor::checkLastFrame()
     else
         mCalibData->cameraMatrix.copyTo(tmpCamMatrix);
 
-    if(mBoardType != TemplateType::chAruco) {
-        cv::Mat r, t, angles;
-        cv::solvePnP(mCalibData->objectPoints.back(), mCurrentImagePoints, tmpCamMatrix, mCalibData->distCoeffs, r, t);
-        RodriguesToEuler(r, angles, CALIB_DEGREES);
-
-        if(fabs(angles.at<double>(0)) > badAngleThresh || fabs(angles.at<double>(1)) > badAngleThresh) {
-            mCalibData->objectPoints.pop_back();
-            mCalibData->imagePoints.pop_back();
-            isFrameBad = true;
-        }
+    const std::vector<cv::Point3f>& boardModel = mCalibData->observations.boardModel();
+    std::vector<cv::Point3f> objectPoints;
+    cv::Mat imagePoints;
+    if(mBoardType == TemplateType::chAruco) {
+        imagePoints = mCurrentCharucoCorners.reshape(2, 1);
+        objectPoints.reserve(mCurrentCharucoIds.total());
+        for(size_t i = 0; i < mCurrentCharucoIds.total(); i++)
+            objectPoints.push_back(boardModel[mCurrentCharucoIds.at<int>((int)i)]);
     }
     else {
-        cv::Mat r, t, angles;
-        std::vector<cv::Point3f> allObjPoints;
-        allObjPoints.reserve(mCurrentCharucoIds.total());
-        for(size_t i = 0; i < mCurrentCharucoIds.total(); i++) {
-            int pointID = mCurrentCharucoIds.at<int>(i);
-            CV_Assert(pointID >= 0 && pointID < (int)mCharucoBoard->chessboardCorners.size());
-            allObjPoints.push_back(mCharucoBoard->chessboardCorners[pointID]);
-        }
+        imagePoints = cv::Mat(mCurrentImagePoints).reshape(2, 1);
+        objectPoints = boardModel;
+    }
 
-        cv::solvePnP(allObjPoints, mCurrentCharucoCorners, tmpCamMatrix, mCalibData->distCoeffs, r, t);
-        RodriguesToEuler(r, angles, CALIB_DEGREES);
+    cv::Mat r, t, angles;
+    cv::solvePnP(objectPoints, imagePoints, tmpCamMatrix, mCalibData->distCoeffs, r, t);
+    RodriguesToEuler(r, angles, CALIB_DEGREES);
 
-        if(180.0 - fabs(angles.at<double>(0)) > badAngleThresh || fabs(angles.at<double>(1)) > badAngleThresh) {
-            isFrameBad = true;
-            mCalibData->allCharucoCorners.pop_back();
-            mCalibData->allCharucoIds.pop_back();
-        }
+    // the charuco board faces the camera at +-180 degrees
+    double tiltX = angles.at<double>(0);
+    if(mBoardType == TemplateType::chAruco)
+        tiltX = tiltX > 0 ? tiltX - 180. : tiltX + 180.;
+
+    if(fabs(tiltX) > maxBoardAngle || fabs(angles.at<double>(1)) > maxBoardAngle)
+        isFrameBad = true;
+    else {
+        // views in a full pose bin are redundant
+        mCurrentPoseBin = poseIndex::binOf(tiltX, angles.at<double>(1), imagePoints, mCalibData->imageSize);
+        isFrameBad = mCalibData->poses.isSaturated(mCurrentPoseBin);
     }
     return isFrameBad;
 }
@@ -253,6 +257,9 @@ CalibProcessor::CalibProcessor(Sptr<calibrationData> data, captureParameters &ca
 {
     mCapuredFrames = 0;
     mNeededFramesNum = capParams.calibrationStep;
+    mCandidatePoolSize = capParams.candidatePoolSize;
+    mCurrentPoseBin = 0;
+    mCalibData->poses.setBinCapacity(capParams.poseBinCapacity);
     mDelayBetweenCaptures = static_cast<int>(capParams.captureDelay * capParams.fps);
     mMaxTemplateOffset = std::sqrt(std::pow(mCalibData->imageSize.height, 2) +
                                    std::pow(mCalibData->imageSize.width, 2)) / 20.0;
@@ -276,6 +283,7 @@ CalibProcessor::CalibProcessor(Sptr<calibrationData> data, captureParameters &ca
     case TemplateType::Chessboard:
         break;
     }
+    initBoardModel();
 }
 
 cv::Mat CalibProcessor::processFrame(const cv::Mat &frame)
@@ -305,11 +313,11 @@ cv::Mat CalibProcessor::processFrame(const cv::Mat &frame)
         mTemplateLocations.pop_back();
     if(mTemplateLocations.size() == mDelayBetweenCaptures && isTemplateFound) {
         if(cv::norm(mTemplateLocations.front() - mTemplateLocations.back()) < mMaxTemplateOffset) {
-            saveFrameData();
             bool isFrameBad = checkLastFrame();
             if (!isFrameBad) {
-                std::string displayMessage = cv::format("Frame # %d captured", std::max(mCalibData->imagePoints.size(),
-                                                                                        mCalibData->allCharucoCorners.size()));
+                saveFrameData();
+                std::string displayMessage = cv::format("Frame # %d captured",
+                                                        (int)mCalibData->observations.viewsCount());
                 if(!showOverlayMessage(displayMessage))
                     showCaptureMessage(frame, displayMessage);
                 mCapuredFrames++;
@@ -329,6 +337,9 @@ cv::Mat CalibProcessor::processFrame(const cv::Mat &frame)
 
 bool CalibProcessor::isProcessed() const
 {
+    // with a candidate pool the calibration waits until the pool is full
+    if(mCandidatePoolSize > 0)
+        return mCalibData->observations.viewsCount() >= (size_t)mCandidatePoolSize;
     if(mCapuredFrames < mNeededFramesNum)
         return false;
     else
@@ -363,15 +374,9 @@ void ShowProcessor::drawBoard(cv::Mat &img, cv::InputArray &points)
 
 void ShowProcessor::drawGridPoints(const cv::Mat &frame)
 {
-    if(mBoardType != TemplateType::chAruco)
-        for(auto it = mCalibData->imagePoints.begin(); it != mCalibData->imagePoints.end(); ++it)
-            for(auto pointIt = (*it).begin(); pointIt != (*it).end(); ++pointIt)
-                cv::circle(frame, *pointIt, POINT_SIZE, cv::Scalar(0, 255, 0), 1, cv::LINE_AA);
-    else
-        for(auto it = mCalibData->allCharucoCorners.begin(); it != mCalibData->allCharucoCorners.end(); ++it)
-            for(int i = 0; i < (*it).size[0]; i++)
-                cv::circle(frame, cv::Point((int)(*it).at<float>(i, 0), (int)(*it).at<float>(i, 1)),
-                           POINT_SIZE, cv::Scalar(0, 255, 0), 1, cv::LINE_AA);
+    cv::Mat allPoints = mCalibData->observations.allPoints();
+    for(size_t i = 0; i < allPoints.total(); i++)
+        cv::circle(frame, allPoints.at<cv::Point2f>((int)i), POINT_SIZE, cv::Scalar(0, 255, 0), 1, cv::LINE_AA);
 }
 
 ShowProcessor::ShowProcessor(Sptr<calibrationData> data, Sptr<calibController> controller, TemplateType board) :
@@ -484,21 +489,18 @@ void ShowProcessor::updateBoardsView()
     if(mVisMode == visualisationMode::Window) {
         cv::Size originSize = mCalibData->imageSize;
         cv::Mat altGridView = cv::Mat::zeros((int)(originSize.height*mGridViewScale), (int)(originSize.width*mGridViewScale), CV_8UC3);
-        if(mBoardType != TemplateType::chAruco)
-            for(auto it = mCalibData->imagePoints.begin(); it != mCalibData->imagePoints.end(); ++it)
-                if(mBoardType != TemplateType::DoubleAcirclesGrid)
-                    drawBoard(altGridView, *it);
-                else {
-                    size_t pointsNum = (*it).size()/2;
-                    std::vector<cv::Point2f> points(pointsNum);
-                    std::copy_n((*it).begin(), pointsNum, points.begin());
-                    drawBoard(altGridView, points);
-                    std::copy_n((*it).begin() + pointsNum, pointsNum, points.begin());
-                    drawBoard(altGridView, points);
-                }
-        else
-            for(auto it = mCalibData->allCharucoCorners.begin(); it != mCalibData->allCharucoCorners.end(); ++it)
-                drawBoard(altGridView, *it);
+        const observationStore& observations = mCalibData->observations;
+        for(size_t i = 0; i < observations.viewsCount(); i++) {
+            cv::Mat points = observations.viewPoints(i);
+            if(mBoardType != TemplateType::DoubleAcirclesGrid)
+                drawBoard(altGridView, points);
+            else {
+                int pointsNum = points.cols/2;
+                cv::Mat whitePart = points.colRange(0, pointsNum), blackPart = points.colRange(pointsNum, 2*pointsNum);
+                drawBoard(altGridView, whitePart);
+                drawBoard(altGridView, blackPart);
+            }
+        }
         cv::imshow(gridWindowName, altGridView);
     }
 }
@@ -0,0 +1,114 @@
+#include "levMarqSchur.hpp"
+#include "linalg.hpp"
+
+using namespace cv;
+
+static const int NINTRINSIC = CV_CALIB_NINTRINSIC;
+typedef Matx<double, NINTRINSIC, NINTRINSIC> MatxII;
+typedef Matx<double, NINTRINSIC, 6> MatxIE;
+typedef Matx<double, NINTRINSIC, 1> VecI;
+typedef Matx<double, 6, 1> VecE;
+
+// intrinsic blocks are compacted to the first nintrinsic rows, the rest of the reduced system is trivial
+static void applyIntrinsicMask(int nintrinsic, MatxII& S, VecI& rhs)
+{
+    for( int k = nintrinsic; k < NINTRINSIC; k++ )
+    {
+        for( int l = 0; l < NINTRINSIC; l++ )
+            S(k, l) = S(l, k) = 0;
+        S(k, k) = 1;
+        rhs(k) = 0;
+    }
+}
+
+cvfork::CvLevMarqSchur::CvLevMarqSchur(int _nviews, CvTermCriteria criteria0) :
+    nviews(_nviews)
+{
+    int nparams = NINTRINSIC + nviews*6;
+
+    initState(nparams, criteria0, false);
+    JtErr.reset(cvCreateMat( nparams, 1, CV_64F ));
+
+    JtJii.create(NINTRINSIC, NINTRINSIC, CV_64F);
+    JtJie.create(nviews*NINTRINSIC, 6, CV_64F);
+    JtJee.create(nviews*6, 6, CV_64F);
+    viewInv.create(nviews*6, 6, CV_64F);
+}
+
+cvfork::CvLevMarqSchur::~CvLevMarqSchur()
+{
+}
+
+void cvfork::CvLevMarqSchur::clearNormalEquations()
+{
+    JtJii = Scalar(0);
+    JtJie = Scalar(0);
+    JtJee = Scalar(0);
+    cvZero( JtErr );
+}
+
+void cvfork::CvLevMarqSchur::initLayout()
+{
+    buildIntrinsicIndex();
+}
+
+Mat cvfork::CvLevMarqSchur::intrinsicBlock()
+{
+    int nintrinsic = (int)intrinsicIdx.size();
+    return JtJii(Rect(0, 0, nintrinsic, nintrinsic));
+}
+
+Mat cvfork::CvLevMarqSchur::viewBlock(int view)
+{
+    return JtJee.rowRange(view*6, view*6 + 6);
+}
+
+Mat cvfork::CvLevMarqSchur::couplingBlock(int view)
+{
+    return JtJie.rowRange(view*NINTRINSIC, view*NINTRINSIC + (int)intrinsicIdx.size());
+}
+
+void cvfork::CvLevMarqSchur::step()
+{
+    const double LOG10 = log(10.);
+    double lambda = exp(lambdaLg10*LOG10);
+    const double* _JtErr = JtErr->data.db;
+    const double* pparam = prevParam->data.db;
+    double* _param = param->data.db;
+
+    // reduced camera system: (U - sum W*V^-1*W^t) * di = ei - sum W*V^-1*ee
+    MatxII S(JtJii.ptr<double>());
+    VecI rhs(_JtErr);
+    for( int k = 0; k < NINTRINSIC; k++ )
+        S(k, k) *= 1. + lambda;
+
+    for( int i = 0; i < nviews; i++ )
+    {
+        Matx66d Vinv;
+        cvfork::invertViewBlock(JtJee.ptr<double>(i*6), 1. + lambda, Vinv);
+        std::copy(Vinv.val, Vinv.val + 36, viewInv.ptr<double>(i*6));
+
+        MatxIE W(JtJie.ptr<double>(i*NINTRINSIC));
+        MatxIE Y = W*Vinv;
+        S -= Y*W.t();
+        rhs -= Y*VecE(_JtErr + NINTRINSIC + i*6);
+    }
+    applyIntrinsicMask((int)intrinsicIdx.size(), S, rhs);
+
+    VecI di;
+    Mat _S(NINTRINSIC, NINTRINSIC, CV_64F, S.val), _di(NINTRINSIC, 1, CV_64F, di.val);
+    linearSolver.solve(_S, Mat(rhs), _di, solveMethod);
+
+    std::copy(pparam, pparam + NINTRINSIC, _param);
+    for( size_t j = 0; j < intrinsicIdx.size(); j++ )
+        _param[intrinsicIdx[j]] = pparam[intrinsicIdx[j]] - di((int)j);
+
+    for( int i = 0; i < nviews; i++ )
+    {
+        Matx66d Vinv(viewInv.ptr<double>(i*6));
+        MatxIE W(JtJie.ptr<double>(i*NINTRINSIC));
+        VecE de = Vinv*(VecE(_JtErr + NINTRINSIC + i*6) - W.t()*di);
+        for( int k = 0; k < 6; k++ )
+            _param[NINTRINSIC + i*6 + k] = pparam[NINTRINSIC + i*6 + k] - de(k);
+    }
+}
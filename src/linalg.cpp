@@ -1,6 +1,11 @@
 #include "linalg.hpp"
+#include <opencv2/core/hal/hal.hpp>
+#include <cmath>
+#include <limits>
 
 #ifdef USE_LAPACK
+#include <cassert>
+#include <cfloat>
 
 #ifdef HAVE_VECLIB
   #include <vecLib/clapack.h>
@@ -9,48 +14,36 @@
   typedef __CLPK_real       real;
 #else
   typedef int    integer;
-  typedef int lapack_int;
-  #include <lapacke.h>
-
-extern void sgelsd_( lapack_int* m, lapack_int* n, lapack_int* nrhs, float* a,
-                          lapack_int* lda, float* b, lapack_int* ldb, float* s,
-                          float* rcond, lapack_int* rank, float* work,
-                          lapack_int* lwork, lapack_int* iwork, lapack_int *info );
-extern void dgelsd_( lapack_int* m, lapack_int* n, lapack_int* nrhs, double* a,
-                    lapack_int* lda, double* b, lapack_int* ldb, double* s,
-                    double* rcond, lapack_int* rank, double* work,
-                    lapack_int* lwork, lapack_int* iwork, lapack_int *info );
-
-extern void sgels_( char* trans, lapack_int* m, lapack_int* n, lapack_int* nrhs,
-                   float* a, lapack_int* lda, float* b, lapack_int* ldb,
-                   float* work, lapack_int* lwork, lapack_int *info );
-extern void dgels_( char* trans, lapack_int* m, lapack_int* n, lapack_int* nrhs,
-                          double* a, lapack_int* lda, double* b, lapack_int* ldb,
-                          double* work, lapack_int* lwork, lapack_int *info );
-extern void spotrf_( char* uplo, lapack_int* n, float* a, lapack_int* lda,
-                    lapack_int *info );
-extern void spotrs_( char* uplo, lapack_int* n, lapack_int* nrhs, const float* a,
-                                lapack_int* lda, float* b, lapack_int* ldb,
-                                lapack_int *info );
-extern void dpotrf_( char* uplo, lapack_int* n, double* a, lapack_int* lda,
-                           lapack_int *info );
-extern void dpotrs_( char* uplo, lapack_int* n, lapack_int* nrhs,
-                    const double* a, lapack_int* lda, double* b,
-                    lapack_int* ldb, lapack_int *info );
-extern void sgesv_( lapack_int* n, lapack_int* nrhs, float* a, lapack_int* lda,
-                   lapack_int* ipiv, float* b, lapack_int* ldb,
-                   lapack_int *info );
-extern void dgesv_( lapack_int* n, lapack_int* nrhs, double* a, lapack_int* lda,
-                          lapack_int* ipiv, double* b, lapack_int* ldb,
-                          lapack_int *info );
-extern void sgesdd_( char* jobz, lapack_int* m, lapack_int* n, float* a,
-                           lapack_int* lda, float* s, float* u, lapack_int* ldu,
-                           float* vt, lapack_int* ldvt, float* work, lapack_int* lwork,
-                           lapack_int* iwork, lapack_int *info );
-extern void dgesdd_( char* jobz, lapack_int* m, lapack_int* n, double* a,
-                           lapack_int* lda, double* s, double* u, lapack_int* ldu,
-                           double* vt, lapack_int* ldvt, double* work,
-                           lapack_int* lwork, lapack_int* iwork, lapack_int *info );
+
+// Fortran LAPACK routines, they are called directly and don't need lapacke.h
+extern "C" {
+void sgelsd_( integer* m, integer* n, integer* nrhs, float* a, integer* lda, float* b, integer* ldb,
+              float* s, float* rcond, integer* rank, float* work, integer* lwork, integer* iwork,
+              integer *info );
+void dgelsd_( integer* m, integer* n, integer* nrhs, double* a, integer* lda, double* b,
+              integer* ldb, double* s, double* rcond, integer* rank, double* work, integer* lwork,
+              integer* iwork, integer *info );
+void sgels_( char* trans, integer* m, integer* n, integer* nrhs, float* a, integer* lda, float* b,
+             integer* ldb, float* work, integer* lwork, integer *info );
+void dgels_( char* trans, integer* m, integer* n, integer* nrhs, double* a, integer* lda, double* b,
+             integer* ldb, double* work, integer* lwork, integer *info );
+void spotrf_( char* uplo, integer* n, float* a, integer* lda, integer *info );
+void spotrs_( char* uplo, integer* n, integer* nrhs, const float* a, integer* lda, float* b,
+              integer* ldb, integer *info );
+void dpotrf_( char* uplo, integer* n, double* a, integer* lda, integer *info );
+void dpotrs_( char* uplo, integer* n, integer* nrhs, const double* a, integer* lda, double* b,
+              integer* ldb, integer *info );
+void sgesv_( integer* n, integer* nrhs, float* a, integer* lda, integer* ipiv, float* b,
+             integer* ldb, integer *info );
+void dgesv_( integer* n, integer* nrhs, double* a, integer* lda, integer* ipiv, double* b,
+             integer* ldb, integer *info );
+void sgesdd_( char* jobz, integer* m, integer* n, float* a, integer* lda, float* s, float* u,
+              integer* ldu, float* vt, integer* ldvt, float* work, integer* lwork, integer* iwork,
+              integer *info );
+void dgesdd_( char* jobz, integer* m, integer* n, double* a, integer* lda, double* s, double* u,
+              integer* ldu, double* vt, integer* ldvt, double* work, integer* lwork, integer* iwork,
+              integer *info );
+}
 #endif
 
 using namespace cv;
@@ -129,7 +122,7 @@ bool cvfork::solve(InputArray _src, const InputArray _src2arg, OutputArray _dst,
         else if( method == DECOMP_CHOLESKY )
             ;
         else
-            CV_Error( CV_StsBadArg, "Unknown method" );
+            CV_Error( cv::Error::StsBadArg, "Unknown method" );
         assert(info == 0);
 
         lwork = cvRound(type == CV_32F ? (double)fwork1 : work1);
@@ -205,7 +198,7 @@ bool cvfork::solve(InputArray _src, const InputArray _src2arg, OutputArray _dst,
                     s, &rcond, &rank, work, &lwork, iwork, &info);
             }
         }
-        else if( method == CV_QR )
+        else if( method == DECOMP_QR )
         {
             if( type == CV_32F )
             {
@@ -220,7 +213,7 @@ bool cvfork::solve(InputArray _src, const InputArray _src2arg, OutputArray _dst,
                     (double*)xt.data, &ldx, work, &lwork, &info);
             }
         }
-        else if( method == CV_CHOLESKY || (method == CV_LU && is_normal) )
+        else if( method == DECOMP_CHOLESKY || (method == DECOMP_LU && is_normal) )
         {
             if( type == CV_32F )
             {
@@ -235,7 +228,7 @@ bool cvfork::solve(InputArray _src, const InputArray _src2arg, OutputArray _dst,
                     dpotrs_(L, &n, &nb, (double*)at.data, &lda, (double*)xt.data, &ldx, &info);
             }
         }
-        else if( method == CV_LU )
+        else if( method == DECOMP_LU )
         {
             iwork = (integer*)alignPtr(ptr, sizeof(integer));
             if( type == CV_32F )
@@ -494,7 +487,7 @@ static void _backSubst( const InputArray& _w, const InputArray& _u, const InputA
                (double*)vt.data, (int)(vt.step/esz), true, (double*)rhs.data, (int)(rhs.step/esz),
                nb, (double*)dst.data, (int)(dst.step/esz), buffer, 2*DBL_EPSILON );
     else
-        CV_Error( CV_StsUnsupportedFormat, "" );
+        CV_Error( cv::Error::StsUnsupportedFormat, "" );
 }
 ///////////////////////////////////////////
 
@@ -536,3 +529,499 @@ double cvfork::invert( InputArray _src, OutputArray _dst, int method )
 }
 
 #endif //USE_LAPACK
+
+// lower bound of the condition number of the Jacobi-scaled matrix at which a factorization is rejected
+static const double SYMMETRIC_SOLVER_MAX_CONDITION = 1e12;
+// panel width of the built-in Cholesky factorization
+static const int CHOLESKY_BLOCK_SIZE = 32;
+// timed solves of every backend in selectFastestLinalgBackend()
+static const int LINALG_BENCHMARK_RUNS = 10;
+
+#ifdef USE_LAPACK
+static int currentLinalgBackend = cvfork::LINALG_LAPACK;
+#else
+static int currentLinalgBackend = cvfork::LINALG_BUILTIN;
+#endif
+
+// pivots of a triangular factor (squared for Cholesky) bound the condition number from below
+static bool isWellConditioned( const double* pivots, size_t step, int n, bool squared )
+{
+    double maxPivot = 0, minPivot = DBL_MAX;
+    for( int i = 0; i < n; i++ )
+    {
+        double d = std::abs(pivots[i*step + i]);
+        if( squared )
+            d *= d;
+        maxPivot = std::max(maxPivot, d);
+        minPivot = std::min(minPivot, d);
+    }
+    return minPivot*SYMMETRIC_SOLVER_MAX_CONDITION >= maxPivot;
+}
+
+// Householder QR of the row-major n x n matrix a, R overwrites its upper triangle and x = b is
+// replaced by the solution. cv::solve doesn't give access to R, so its pivots are checked here
+static bool householderSolve( double* a, size_t astep, int n, double* x, bool checkCondition )
+{
+    for( int k = 0; k < n; k++ )
+    {
+        double norm = 0;
+        for( int i = k; i < n; i++ )
+            norm += a[i*astep + k]*a[i*astep + k];
+        norm = std::sqrt(norm);
+        if( norm < DBL_MIN )
+            return false;
+
+        // v = column - alpha*e_k is kept in place of the column below the diagonal
+        double alpha = a[k*astep + k] > 0 ? -norm : norm;
+        double vnorm2 = 2*norm*(norm + std::abs(a[k*astep + k]));
+        a[k*astep + k] -= alpha;
+        for( int j = k + 1; j < n; j++ )
+        {
+            double s = 0;
+            for( int i = k; i < n; i++ )
+                s += a[i*astep + k]*a[i*astep + j];
+            s *= 2/vnorm2;
+            for( int i = k; i < n; i++ )
+                a[i*astep + j] -= s*a[i*astep + k];
+        }
+        double s = 0;
+        for( int i = k; i < n; i++ )
+            s += a[i*astep + k]*x[i];
+        s *= 2/vnorm2;
+        for( int i = k; i < n; i++ )
+            x[i] -= s*a[i*astep + k];
+        a[k*astep + k] = alpha;
+    }
+
+    if( checkCondition && !isWellConditioned(a, astep, n, false) )
+        return false;
+    for( int i = n - 1; i >= 0; i-- )
+    {
+        double s = x[i];
+        for( int j = i + 1; j < n; j++ )
+            s -= a[i*astep + j]*x[j];
+        x[i] = s/a[i*astep + i];
+    }
+    return true;
+}
+
+namespace {
+
+// cv::solve, Cholesky goes through cv::hal and QR with the condition check through
+// householderSolve() to get at the pivots
+class OpenCVBackend : public cvfork::LinalgBackend
+{
+public:
+    virtual void prepare( int, int ) {}
+
+    virtual bool solve( cv::Mat& A, const cv::Mat& b, cv::Mat& x, int method, bool checkCondition )
+    {
+        if( method == cv::DECOMP_QR && checkCondition )
+        {
+            b.copyTo(x);
+            return householderSolve(A.ptr<double>(), A.step1(), A.rows, x.ptr<double>(), true);
+        }
+        if( method != cv::DECOMP_CHOLESKY )
+            return cv::solve(A, b, x, method);
+
+        b.copyTo(x);
+        if( !cv::hal::Cholesky64f(A.ptr<double>(), A.step, A.rows, x.ptr<double>(), x.step, 1) )
+            return false;
+        // the diagonal of the factor is stored inverted, so the ratio of pivots is the same
+        return !checkCondition || isWellConditioned(A.ptr<double>(), A.step1(), A.rows, true);
+    }
+};
+
+// right-looking blocked Cholesky on the row-major lower triangle: every panel is factored,
+// then the trailing matrix is updated by dot products of contiguous row segments
+class BuiltinBackend : public OpenCVBackend
+{
+public:
+    virtual bool solve( cv::Mat& A, const cv::Mat& b, cv::Mat& x, int method, bool checkCondition )
+    {
+        if( method != cv::DECOMP_CHOLESKY )
+            return OpenCVBackend::solve(A, b, x, method, checkCondition);
+
+        int n = A.rows;
+        size_t astep = A.step1();
+        double* a = A.ptr<double>();
+        if( !factor(a, astep, n) || (checkCondition && !isWellConditioned(a, astep, n, true)) )
+            return false;
+
+        b.copyTo(x);
+        double* px = x.ptr<double>();
+        for( int i = 0; i < n; i++ )
+        {
+            const double* row = a + i*astep;
+            double s = px[i];
+            for( int k = 0; k < i; k++ )
+                s -= row[k]*px[k];
+            px[i] = s/row[i];
+        }
+        for( int i = n - 1; i >= 0; i-- )
+        {
+            double s = px[i];
+            for( int k = i + 1; k < n; k++ )
+                s -= a[k*astep + i]*px[k];
+            px[i] = s/a[i*astep + i];
+        }
+        return true;
+    }
+
+protected:
+    static double dot( const double* u, const double* v, int len )
+    {
+        double s0 = 0, s1 = 0;
+        int k = 0;
+        for( ; k <= len - 2; k += 2 )
+        {
+            s0 += u[k]*v[k];
+            s1 += u[k + 1]*v[k + 1];
+        }
+        for( ; k < len; k++ )
+            s0 += u[k]*v[k];
+        return s0 + s1;
+    }
+
+    static bool factor( double* a, size_t astep, int n )
+    {
+        for( int k0 = 0; k0 < n; k0 += CHOLESKY_BLOCK_SIZE )
+        {
+            int k1 = std::min(k0 + CHOLESKY_BLOCK_SIZE, n);
+
+            // the panel: columns [k0, k1) of all the rows below k0, previous panels are already applied
+            for( int j = k0; j < k1; j++ )
+            {
+                double* rowj = a + j*astep;
+                double d = rowj[j] - dot(rowj + k0, rowj + k0, j - k0);
+                if( d < std::numeric_limits<double>::epsilon() )
+                    return false;
+                rowj[j] = std::sqrt(d);
+                for( int i = j + 1; i < n; i++ )
+                {
+                    double* rowi = a + i*astep;
+                    rowi[j] = (rowi[j] - dot(rowi + k0, rowj + k0, j - k0))/rowj[j];
+                }
+            }
+
+            // the trailing lower triangle
+            for( int i = k1; i < n; i++ )
+            {
+                double* rowi = a + i*astep;
+                for( int j = k1; j <= i; j++ )
+                    rowi[j] -= dot(rowi + k0, a + j*astep + k0, k1 - k0);
+            }
+        }
+        return true;
+    }
+};
+
+#ifdef USE_LAPACK
+// workspace size, work buffers and pivots are kept between the calls
+class LapackBackend : public cvfork::LinalgBackend
+{
+public:
+    LapackBackend() : n(0), lwork(0) {}
+
+    virtual void prepare( int _n, int method )
+    {
+        n = _n;
+        lwork = 0;
+        integer m = n, nb = 1, ld = n, query = -1, rank = 0, info = 0, iwork1 = 0;
+        double work1 = 0, s1 = 0, rcond = -1;
+        char N[] = {'N', '\0'};
+        // Cholesky steps fall back to QR and SVD, so their workspaces are prepared as well
+        bool adaptive = method == DECOMP_CHOLESKY;
+
+        if( method == DECOMP_SVD || method == DECOMP_EIG || adaptive )
+        {
+            integer nlvl = cvRound(std::log(std::max(n/25., 1.))/CV_LOG2) + 1;
+            integer liwork = n*(3*std::max(nlvl, (integer)0) + 11);
+            dgelsd_(&m, &m, &nb, 0, &ld, 0, &ld, &s1, &rcond, &rank, &work1, &query, &iwork1, &info);
+            s.resize(n);
+            iwork.resize((liwork + 1)*sizeof(integer));
+            lwork = cvRound(work1);
+        }
+        if( method == DECOMP_QR || adaptive )
+        {
+            dgels_(N, &m, &m, &nb, 0, &ld, 0, &ld, &work1, &query, &info);
+            lwork = std::max(lwork, cvRound(work1));
+        }
+        if( method == DECOMP_LU )
+            iwork.resize((n + 1)*sizeof(integer));
+        else if( method != DECOMP_SVD && method != DECOMP_EIG && method != DECOMP_QR && !adaptive )
+            CV_Error( cv::Error::StsBadArg, "Unknown method" );
+        CV_Assert( info == 0 );
+
+        work.resize(std::max(lwork, 1));
+    }
+
+    virtual bool solve( Mat& A, const Mat& b, Mat& x, int method, bool checkCondition )
+    {
+        b.copyTo(x);
+        CV_Assert( x.isContinuous() && A.step[1] == sizeof(double) );
+
+        integer m = n, nb = 1, lda = (integer)A.step1(), ldx = n, rank = 0, info = 0, _lwork = lwork;
+        double rcond = -1, *a = A.ptr<double>(), *px = x.ptr<double>();
+        integer* _iwork = iwork.empty() ? 0 : (integer*)&iwork[0];
+        char N[] = {'N', '\0'}, L[] = {'L', '\0'};
+
+        // row-major storage of a symmetric matrix is its column-major storage as well
+        if( method == DECOMP_SVD || method == DECOMP_EIG )
+            dgelsd_(&m, &m, &nb, a, &lda, px, &ldx, &s[0], &rcond, &rank, &work[0], &_lwork, _iwork, &info);
+        else if( method == DECOMP_QR )
+            dgels_(N, &m, &m, &nb, a, &lda, px, &ldx, &work[0], &_lwork, &info);
+        else if( method == DECOMP_LU )
+            dgesv_(&m, &nb, a, &lda, _iwork, px, &ldx, &info);
+        else
+        {
+            dpotrf_(L, &m, a, &lda, &info);
+            if( info == 0 )
+                dpotrs_(L, &m, &nb, a, &lda, px, &ldx, &info);
+        }
+
+        // diagonals of the Cholesky factor and of R
+        if( info == 0 && checkCondition && (method == DECOMP_CHOLESKY || method == DECOMP_QR) &&
+            !isWellConditioned(a, lda, n, method == DECOMP_CHOLESKY) )
+            return false;
+
+        if( info != 0 )
+        {
+            x = Scalar(0);
+            return false;
+        }
+        return true;
+    }
+
+protected:
+    int n, lwork;
+    std::vector<double> work, s;
+    std::vector<uchar> iwork;
+};
+#endif
+
+}
+
+bool cvfork::isLinalgBackendAvailable( int backend )
+{
+#ifndef USE_LAPACK
+    if( backend == LINALG_LAPACK )
+        return false;
+#endif
+    return backend >= 0 && backend < LINALG_BACKEND_COUNT;
+}
+
+const char* cvfork::getLinalgBackendName( int backend )
+{
+    static const char* names[] = { "opencv", "lapack", "builtin" };
+    CV_Assert( 0 <= backend && backend < LINALG_BACKEND_COUNT );
+    return names[backend];
+}
+
+int cvfork::getLinalgBackendByName( const std::string& name )
+{
+    for( int backend = 0; backend < LINALG_BACKEND_COUNT; backend++ )
+        if( name == getLinalgBackendName(backend) )
+            return backend;
+    return -1;
+}
+
+void cvfork::setLinalgBackend( int backend )
+{
+    if( !isLinalgBackendAvailable(backend) )
+        CV_Error( cv::Error::StsBadArg, "The linear algebra backend is not available in this build" );
+    currentLinalgBackend = backend;
+}
+
+int cvfork::getLinalgBackend()
+{
+    return currentLinalgBackend;
+}
+
+cv::Ptr<cvfork::LinalgBackend> cvfork::createLinalgBackend( int backend )
+{
+    CV_Assert( isLinalgBackendAvailable(backend) );
+    if( backend == LINALG_OPENCV )
+        return cv::makePtr<OpenCVBackend>();
+#ifdef USE_LAPACK
+    if( backend == LINALG_LAPACK )
+        return cv::makePtr<LapackBackend>();
+#endif
+    return cv::makePtr<BuiltinBackend>();
+}
+
+int cvfork::selectFastestLinalgBackend( int n, int method )
+{
+    // a damped normal matrix of a random Jacobian with twice as many residuals as unknowns
+    cv::RNG rng(0x1234567);
+    cv::Mat J(2*n, n, CV_64F), A0, b(n, 1, CV_64F), A, x;
+    rng.fill(J, cv::RNG::UNIFORM, -1., 1.);
+    rng.fill(b, cv::RNG::UNIFORM, -1., 1.);
+    cv::mulTransposed(J, A0, true);
+    A0.diag() *= 1.001;
+
+    int best = currentLinalgBackend;
+    double bestTime = DBL_MAX;
+    for( int backend = 0; backend < LINALG_BACKEND_COUNT; backend++ )
+    {
+        if( !isLinalgBackendAvailable(backend) )
+            continue;
+        currentLinalgBackend = backend;
+        SymmetricSolver solver;
+
+        // the first solve allocates the workspace and isn't timed
+        A0.copyTo(A);
+        solver.solve(A, b, x, method);
+        int64 start = cv::getTickCount();
+        for( int k = 0; k < LINALG_BENCHMARK_RUNS; k++ )
+        {
+            A0.copyTo(A);
+            solver.solve(A, b, x, method);
+        }
+        double time = (double)(cv::getTickCount() - start);
+        if( time < bestTime )
+        {
+            bestTime = time;
+            best = backend;
+        }
+    }
+    currentLinalgBackend = best;
+    return best;
+}
+
+cvfork::SymmetricSolver::SymmetricSolver() :
+    n(0), method(-1), backend(createLinalgBackend(getLinalgBackend())) {}
+
+const cvfork::DecompCounters& cvfork::SymmetricSolver::counters() const
+{
+    return decompCounters;
+}
+
+bool cvfork::SymmetricSolver::solve( cv::Mat& A, const cv::Mat& b, cv::Mat& x, int _method )
+{
+    CV_Assert( A.type() == CV_64F && A.rows == A.cols && b.type() == CV_64F &&
+               b.rows == A.rows && b.cols == 1 );
+    if( A.rows != n || _method != method )
+    {
+        n = A.rows;
+        method = _method;
+        backend->prepare(n, method);
+    }
+
+    if( method != cv::DECOMP_CHOLESKY )
+    {
+        bool ok = backend->solve(A, b, x, method, false);
+        if( method == cv::DECOMP_QR )
+            decompCounters.qr++;
+        else if( method == cv::DECOMP_LU )
+            decompCounters.lu++;
+        else
+            decompCounters.svd++;
+        return ok;
+    }
+
+    // the system is Jacobi-scaled, so the pivots measure the conditioning and not the units
+    // of the parameters; its copy is kept for the fallbacks since A is factored in place
+    scale.create(n, 1, CV_64F);
+    scaledRhs.create(n, 1, CV_64F);
+    for( int i = 0; i < n; i++ )
+    {
+        double d = A.at<double>(i, i);
+        scale.at<double>(i) = d > DBL_EPSILON ? 1./std::sqrt(d) : 1.;
+    }
+    for( int i = 0; i < n; i++ )
+    {
+        double* row = A.ptr<double>(i);
+        double si = scale.at<double>(i);
+        for( int j = 0; j < n; j++ )
+            row[j] *= si*scale.at<double>(j);
+        scaledRhs.at<double>(i) = b.at<double>(i)*si;
+    }
+    A.copyTo(scaledCopy);
+
+    bool ok = backend->solve(A, scaledRhs, x, cv::DECOMP_CHOLESKY, true);
+    if( ok )
+        decompCounters.cholesky++;
+    else
+    {
+        scaledCopy.copyTo(A);
+        ok = backend->solve(A, scaledRhs, x, cv::DECOMP_QR, true);
+        if( ok )
+            decompCounters.qr++;
+        else
+        {
+            scaledCopy.copyTo(A);
+            ok = backend->solve(A, scaledRhs, x, cv::DECOMP_SVD, false);
+            decompCounters.svd++;
+        }
+    }
+    cv::multiply(x, scale, x);
+    return ok;
+}
+
+void cvfork::invertViewBlock( const double* src, double diagScale, cv::Matx66d& dst )
+{
+    cv::Matx66d a(src), l;
+    for( int k = 0; k < 6; k++ )
+        a(k, k) *= diagScale;
+    l = a;
+    dst = cv::Matx66d::eye();
+    if( !choleskySolve(l.val, 6*sizeof(double), 6, dst.val, 6*sizeof(double), 6) )
+        cv::invert(a, dst, cv::DECOMP_SVD);
+}
+
+bool cvfork::choleskySolve( double* A, size_t astep, int m, double* B, size_t bstep, int n )
+{
+    int i, j, k;
+    double s;
+    astep /= sizeof(A[0]);
+    bstep /= sizeof(B[0]);
+
+    // the factor diagonal is stored inverted
+    for( i = 0; i < m; i++ )
+    {
+        for( j = 0; j < i; j++ )
+        {
+            s = A[i*astep + j];
+            for( k = 0; k < j; k++ )
+                s -= A[i*astep + k]*A[j*astep + k];
+            A[i*astep + j] = s*A[j*astep + j];
+        }
+        s = A[i*astep + i];
+        for( k = 0; k < i; k++ )
+            s -= A[i*astep + k]*A[i*astep + k];
+        if( s < std::numeric_limits<double>::epsilon() )
+            return false;
+        A[i*astep + i] = 1./std::sqrt(s);
+    }
+
+    if( B )
+        choleskyBackSubst(A, astep*sizeof(A[0]), m, B, bstep*sizeof(B[0]), n);
+    return true;
+}
+
+void cvfork::choleskyBackSubst( const double* L, size_t lstep, int m, double* B, size_t bstep, int n )
+{
+    int i, j, k;
+    double s;
+    lstep /= sizeof(L[0]);
+    bstep /= sizeof(B[0]);
+
+    for( i = 0; i < m; i++ )
+        for( j = 0; j < n; j++ )
+        {
+            s = B[i*bstep + j];
+            for( k = 0; k < i; k++ )
+                s -= L[i*lstep + k]*B[k*bstep + j];
+            B[i*bstep + j] = s*L[i*lstep + i];
+        }
+
+    for( i = m - 1; i >= 0; i-- )
+        for( j = 0; j < n; j++ )
+        {
+            s = B[i*bstep + j];
+            for( k = m - 1; k > i; k-- )
+                s -= L[k*lstep + i]*B[k*bstep + j];
+            B[i*bstep + j] = s*L[i*lstep + i];
+        }
+}
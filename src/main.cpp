@@ -16,6 +16,7 @@
 #include "cvCalibrationFork.hpp"
 #include "calibController.hpp"
 #include "parametersController.hpp"
+#include "modelSelection.hpp"
 #include "rotationConverters.hpp"
 
 using namespace calib;
@@ -106,9 +107,33 @@ int main(int argc, char** argv)
     if(!parser.has("v")) globalData->imageSize = capParams.cameraResolution;
 
     int calibrationFlags = 0;
+    bool solverConverged = true;
     if(intParams.fastSolving) calibrationFlags |= CALIB_USE_QR;
+    if(intParams.schurSolving) calibrationFlags |= CALIB_USE_SCHUR;
+    if(intParams.parallelSolving) calibrationFlags |= CALIB_USE_PARALLEL;
+    if(intParams.reuseFactorization) calibrationFlags |= CALIB_REUSE_FACTORIZATION;
+    if(intParams.doglegSolving) calibrationFlags |= CALIB_USE_DOGLEG;
+    if(intParams.mixedPrecision) calibrationFlags |= CALIB_USE_MIXED_PRECISION;
+    if(intParams.broydenUpdates) calibrationFlags |= CALIB_USE_BROYDEN;
+    if(intParams.divisionModelInit) calibrationFlags |= CALIB_INIT_DIVISION_MODEL;
+    if(intParams.pcgSolving) calibrationFlags |= CALIB_USE_PCG;
+
+    if(intParams.linalgBackend == "auto") {
+        // block solvers factor only the intrinsic system, the dense one works on all the frames
+        int systemSize = CV_CALIB_NINTRINSIC;
+        if(!(calibrationFlags & (CALIB_USE_SCHUR | CALIB_USE_PCG)) || (calibrationFlags & CALIB_USE_DOGLEG))
+            systemSize += 6*capParams.maxFramesNum;
+        int method = (calibrationFlags & CALIB_USE_QR) ? cv::DECOMP_QR : cv::DECOMP_CHOLESKY;
+        int backend = cvfork::selectFastestLinalgBackend(systemSize, method);
+        std::cout << "Linear algebra backend: " << cvfork::getLinalgBackendName(backend) << std::endl;
+    }
+    else if(intParams.linalgBackend != "default")
+        cvfork::setLinalgBackend(cvfork::getLinalgBackendByName(intParams.linalgBackend));
+    // speculative tuning replaces the greedy one
+    bool speculativeTuning = parser.get<bool>("ft") && intParams.speculativeTuning;
     Sptr<calibController> controller(new calibController(globalData, calibrationFlags,
-                                                         parser.get<bool>("ft"), capParams.minFramesNum));
+                                                         parser.get<bool>("ft") && !speculativeTuning,
+                                                         capParams.minFramesNum));
     Sptr<calibDataController> dataController(new calibDataController(globalData, capParams.maxFramesNum,
                                                                      intParams.filterAlpha));
     dataController->setParametersFileName(parser.get<std::string>("of"));
@@ -141,6 +166,14 @@ int main(int argc, char** argv)
         while(true)
         {
             auto exitStatus = pipeline->start(processors);
+            bool lastCalibration = false;
+            size_t framesNum = globalData->observations.viewsCount();
+            if(exitStatus == PipelineExitStatus::Finished && capParams.candidatePoolSize > 0 &&
+                    framesNum >= (size_t)capParams.minFramesNum && framesNum != globalData->perViewErrors.total()) {
+                // the pool left at the end of the input is selected and calibrated before exit
+                exitStatus = PipelineExitStatus::Calibrate;
+                lastCalibration = true;
+            }
             if (exitStatus == PipelineExitStatus::Finished) {
                 if(controller->getCommonCalibrationState())
                     saveCurrentParamsButton(0, &dataController);
@@ -152,38 +185,83 @@ int main(int argc, char** argv)
                 globalData->imageSize = pipeline->getImageSize();
                 calibrationFlags = controller->getNewFlags();
 
+                if(capParams.candidatePoolSize > 0)
+                    dataController->selectFrames();
+
+                cv::TermCriteria termCrit = solverTermCrit;
+                if((intParams.incrementalSolving || !solverConverged) &&
+                        !globalData->rvecs.empty() && globalData->cameraMatrix.total()) {
+                    // start from the previous solution, only new views are initialized from scratch
+                    calibrationFlags |= cv::CALIB_USE_INTRINSIC_GUESS | CALIB_FORK_USE_EXTRINSIC_GUESS;
+                    if(intParams.incrementalSolving)
+                        termCrit.maxCount = intParams.incrementalMaxIters;
+                }
+
+                cvfork::SolverStats solverStats;
                 using namespace std::chrono;
                 auto startPoint = high_resolution_clock::now();
-                if(capParams.board != TemplateType::chAruco) {
-                    globalData->totalAvgErr =
-                            cvfork::calibrateCamera(globalData->objectPoints, globalData->imagePoints,
-                                                    globalData->imageSize, globalData->cameraMatrix,
-                                                    globalData->distCoeffs, cv::noArray(), cv::noArray(),
-                                                    globalData->stdDeviations, globalData->perViewErrors,
-                                                    calibrationFlags, solverTermCrit);
+                if(speculativeTuning && controller->getFramesNumberState()) {
+                    std::vector<calibrationCandidate> candidates = candidateModels(calibrationFlags);
+                    size_t best = calibrateCandidates(*globalData, termCrit, intParams.solverTimeBudget, candidates);
+                    for(size_t i = 0; i < candidates.size(); i++)
+                        std::cout << "Model " << candidates[i].name << ": RMS " << candidates[i].totalAvgErr
+                                  << ", BIC " << candidates[i].criterion << (i == best ? " (chosen)" : "") << "\n";
+
+                    calibrationCandidate& result = candidates[best];
+                    globalData->totalAvgErr = result.totalAvgErr;
+                    globalData->cameraMatrix = result.cameraMatrix;
+                    globalData->distCoeffs = result.distCoeffs;
+                    globalData->stdDeviations = result.stdDeviations;
+                    globalData->perViewErrors = result.perViewErrors;
+                    globalData->perViewLooErrors = result.perViewLooErrors;
+                    globalData->rvecs.swap(result.rvecs);
+                    globalData->tvecs.swap(result.tvecs);
+                    solverStats = result.stats;
+                    controller->setNewFlags(result.flags & ~(cv::CALIB_USE_INTRINSIC_GUESS | CALIB_FORK_USE_EXTRINSIC_GUESS));
                 }
                 else {
-                    cv::Ptr<cv::aruco::Dictionary> dictionary =
-                            cv::aruco::getPredefinedDictionary(cv::aruco::PREDEFINED_DICTIONARY_NAME(capParams.charucoDictName));
-                    cv::Ptr<cv::aruco::CharucoBoard> charucoboard =
-                                cv::aruco::CharucoBoard::create(capParams.boardSize.width, capParams.boardSize.height,
-                                                                capParams.charucoSquareLenght, capParams.charucoMarkerSize, dictionary);
+                    const observationStore& observations = globalData->observations;
                     globalData->totalAvgErr =
-                            cvfork::calibrateCameraCharuco(globalData->allCharucoCorners, globalData->allCharucoIds,
-                                                           charucoboard, globalData->imageSize,
-                                                           globalData->cameraMatrix, globalData->distCoeffs,
-                                                           cv::noArray(), cv::noArray(), globalData->stdDeviations,
-                                                           globalData->perViewErrors, calibrationFlags, solverTermCrit);
+                            cvfork::calibrateCameraIndexed(observations.boardModel(), observations.allIds(),
+                                                           observations.allPoints(), observations.viewSizes(),
+                                                           globalData->imageSize, globalData->cameraMatrix,
+                                                           globalData->distCoeffs, globalData->rvecs, globalData->tvecs,
+                                                           globalData->stdDeviations, cv::noArray(),
+                                                           globalData->perViewErrors, globalData->perViewLooErrors,
+                                                           calibrationFlags, termCrit, &solverStats,
+                                                           intParams.solverTimeBudget);
                 }
                 auto endPoint = high_resolution_clock::now();
 
                 dataController->updateUndistortMap();
                 dataController->printParametersToConsole(std::cout);
                 std::cout << "Calibration time: " << (duration_cast<duration<double>>(endPoint - startPoint)).count() << "\n";
+                std::cout << "Solver iterations: " << solverStats.iterations << ", Jacobian evaluations: "
+                          << solverStats.jacobianEvals << " (" << solverStats.fullJacobianEvals << " full)"
+                          << ", error evaluations: " << solverStats.errorEvals;
+                if(solverStats.linearIterations)
+                    std::cout << ", CG iterations: " << solverStats.linearIterations;
+                std::cout << "\n";
+                const cvfork::DecompCounters& decomps = solverStats.decompositions;
+                std::cout << "Linear solves: " << decomps.cholesky << " Cholesky, " << decomps.qr << " QR, "
+                          << decomps.svd << " SVD, " << decomps.lu << " LU";
+                if(decomps.reused)
+                    std::cout << ", " << decomps.reused << " with a reused factorization";
+                std::cout << "\n";
+                // a partial result is refined further by the next calibration
+                solverConverged = solverStats.converged;
+                if(!solverConverged)
+                    std::cout << "Solver stopped on the time budget, the result is partial\n";
                 controller->updateState();
-                for(int j = 0; j < capParams.calibrationStep; j++)
-                    dataController->filterFrames();
+                if(capParams.candidatePoolSize == 0)
+                    for(int j = 0; j < capParams.calibrationStep; j++)
+                        dataController->filterFrames();
                 static_cast<ShowProcessor*>(showProcessor.get())->updateBoardsView();
+                if(lastCalibration) {
+                    if(controller->getCommonCalibrationState())
+                        saveCurrentParamsButton(0, &dataController);
+                    break;
+                }
             }
             else if (exitStatus == PipelineExitStatus::DeleteLastFrame) {
                 deleteButton(0, &dataController);
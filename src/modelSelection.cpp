@@ -0,0 +1,114 @@
+#include "modelSelection.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <opencv2/calib3d.hpp>
+
+class CandidateCalibrationInvoker : public cv::ParallelLoopBody
+{
+public:
+    CandidateCalibrationInvoker(const calib::calibrationData& _data, cv::TermCriteria _criteria, double _timeBudget,
+                                std::vector<calib::calibrationCandidate>& _candidates) :
+        data(_data), criteria(_criteria), timeBudget(_timeBudget), candidates(_candidates)
+    {
+    }
+
+    virtual void operator()(const cv::Range& range) const
+    {
+        const calib::observationStore& observations = data.observations;
+        for(int i = range.start; i < range.end; i++) {
+            calib::calibrationCandidate& candidate = candidates[i];
+            // every candidate refines its own copy of the guess
+            data.cameraMatrix.copyTo(candidate.cameraMatrix);
+            data.distCoeffs.copyTo(candidate.distCoeffs);
+            candidate.rvecs.resize(data.rvecs.size());
+            candidate.tvecs.resize(data.tvecs.size());
+            for(size_t j = 0; j < data.rvecs.size(); j++)
+                candidate.rvecs[j] = data.rvecs[j].clone();
+            for(size_t j = 0; j < data.tvecs.size(); j++)
+                candidate.tvecs[j] = data.tvecs[j].clone();
+
+            candidate.totalAvgErr =
+                    cvfork::calibrateCameraIndexed(observations.boardModel(), observations.allIds(),
+                                                   observations.allPoints(), observations.viewSizes(),
+                                                   data.imageSize, candidate.cameraMatrix, candidate.distCoeffs,
+                                                   candidate.rvecs, candidate.tvecs, candidate.stdDeviations,
+                                                   cv::noArray(), candidate.perViewErrors, candidate.perViewLooErrors,
+                                                   candidate.flags, criteria, &candidate.stats, timeBudget);
+
+            // BIC of the Gaussian reprojection errors, every point gives two residuals
+            double residualsNum = 2.*observations.pointsCount();
+            double rss = candidate.totalAvgErr*candidate.totalAvgErr*observations.pointsCount();
+            int paramsNum = calib::countIntrinsicParams(candidate.flags) + 6*(int)observations.viewsCount();
+            candidate.criterion = residualsNum*std::log(std::max(rss / residualsNum, DBL_MIN)) +
+                    paramsNum*std::log(residualsNum);
+        }
+    }
+
+private:
+    const calib::calibrationData& data;
+    cv::TermCriteria criteria;
+    double timeBudget;
+    std::vector<calib::calibrationCandidate>& candidates;
+};
+
+std::vector<calib::calibrationCandidate> calib::candidateModels(int baseFlags)
+{
+    int fullFlags = baseFlags & ~(tuningFlags | cv::CALIB_RATIONAL_MODEL | cv::CALIB_THIN_PRISM_MODEL);
+    std::vector<calibrationCandidate> candidates;
+    candidates.push_back(calibrationCandidate("full", fullFlags));
+    candidates.push_back(calibrationCandidate("fixed aspect", fullFlags | cv::CALIB_FIX_ASPECT_RATIO));
+    candidates.push_back(calibrationCandidate("zero tangential", fullFlags | cv::CALIB_ZERO_TANGENT_DIST));
+    candidates.push_back(calibrationCandidate("fixed k3", fullFlags | cv::CALIB_FIX_K3));
+    candidates.push_back(calibrationCandidate("fixed aspect, zero tangential, fixed k3", fullFlags |
+                                              cv::CALIB_FIX_ASPECT_RATIO | cv::CALIB_ZERO_TANGENT_DIST |
+                                              cv::CALIB_FIX_K3));
+    candidates.push_back(calibrationCandidate("rational", fullFlags | cv::CALIB_RATIONAL_MODEL));
+    candidates.push_back(calibrationCandidate("thin prism", fullFlags | cv::CALIB_RATIONAL_MODEL |
+                                              cv::CALIB_THIN_PRISM_MODEL));
+    return candidates;
+}
+
+int calib::countIntrinsicParams(int flags)
+{
+    int paramsNum = 0;
+    if(!(flags & cv::CALIB_FIX_FOCAL_LENGTH))
+        paramsNum += (flags & cv::CALIB_FIX_ASPECT_RATIO) ? 1 : 2;
+    if(!(flags & cv::CALIB_FIX_PRINCIPAL_POINT))
+        paramsNum += 2;
+    paramsNum += !(flags & cv::CALIB_FIX_K1) + !(flags & cv::CALIB_FIX_K2) + !(flags & cv::CALIB_FIX_K3);
+    if(!(flags & cv::CALIB_ZERO_TANGENT_DIST))
+        paramsNum += 2;
+    if(flags & cv::CALIB_RATIONAL_MODEL)
+        paramsNum += !(flags & cv::CALIB_FIX_K4) + !(flags & cv::CALIB_FIX_K5) + !(flags & cv::CALIB_FIX_K6);
+    if((flags & cv::CALIB_THIN_PRISM_MODEL) && !(flags & cv::CALIB_FIX_S1_S2_S3_S4))
+        paramsNum += 4;
+    if((flags & cv::CALIB_TILTED_MODEL) && !(flags & cv::CALIB_FIX_TAUX_TAUY))
+        paramsNum += 2;
+    return paramsNum;
+}
+
+size_t calib::calibrateCandidates(const calibrationData& data, cv::TermCriteria criteria, double timeBudget,
+                                  std::vector<calibrationCandidate>& candidates)
+{
+    CV_Assert(!candidates.empty());
+    // a thread calibrates up to wavesNum candidates one after another, each of them gets its share of the budget
+    int candidatesNum = (int)candidates.size(), threadsNum = std::max(cv::getNumThreads(), 1);
+    int wavesNum = (candidatesNum + threadsNum - 1)/threadsNum;
+    double candidateBudget = timeBudget/wavesNum;
+    CandidateCalibrationInvoker calibrateCandidate(data, criteria, candidateBudget, candidates);
+    cv::parallel_for_(cv::Range(0, candidatesNum), calibrateCandidate, cv::getNumThreads());
+
+    size_t best = 0;
+    for(size_t i = 1; i < candidates.size(); i++) {
+        const calibrationCandidate& candidate = candidates[i];
+        if(candidate.stats.converged != candidates[best].stats.converged) {
+            if(candidate.stats.converged)
+                best = i;
+        }
+        else if(candidate.criterion < candidates[best].criterion)
+            best = i;
+    }
+    return best;
+}
@@ -0,0 +1,135 @@
+#include "observationStore.hpp"
+
+#include <algorithm>
+
+calib::observationStore::observationStore() :
+    mViewOffsets(1, 0)
+{
+}
+
+void calib::observationStore::appendView(size_t pointsNum)
+{
+    mViewSizes.push_back((int)pointsNum);
+    mViewOffsets.push_back(mViewOffsets.back() + (int)pointsNum);
+}
+
+void calib::observationStore::setBoardModel(const std::vector<cv::Point3f>& boardPoints)
+{
+    CV_Assert(mViewSizes.empty());
+    mBoardPoints = boardPoints;
+}
+
+const std::vector<cv::Point3f>& calib::observationStore::boardModel() const
+{
+    return mBoardPoints;
+}
+
+void calib::observationStore::addView(const std::vector<cv::Point2f>& imagePoints)
+{
+    CV_Assert(imagePoints.size() == mBoardPoints.size());
+    mImagePoints.insert(mImagePoints.end(), imagePoints.begin(), imagePoints.end());
+    for(size_t i = 0; i < imagePoints.size(); i++)
+        mPointIds.push_back((int)i);
+    appendView(imagePoints.size());
+}
+
+void calib::observationStore::addView(const cv::Mat& imagePoints, const cv::Mat& pointIds)
+{
+    size_t pointsNum = pointIds.total();
+    CV_Assert(imagePoints.type() == CV_32FC2 && pointIds.type() == CV_32S && imagePoints.total() == pointsNum &&
+              imagePoints.isContinuous() && pointIds.isContinuous());
+    const cv::Point2f* points = imagePoints.ptr<cv::Point2f>();
+    const int* ids = pointIds.ptr<int>();
+    for(size_t i = 0; i < pointsNum; i++)
+        CV_Assert(ids[i] >= 0 && ids[i] < (int)mBoardPoints.size());
+    mImagePoints.insert(mImagePoints.end(), points, points + pointsNum);
+    mPointIds.insert(mPointIds.end(), ids, ids + pointsNum);
+    appendView(pointsNum);
+}
+
+void calib::observationStore::removeView(size_t index)
+{
+    CV_Assert(index < mViewSizes.size());
+    int begin = mViewOffsets[index], size = mViewSizes[index];
+    mImagePoints.erase(mImagePoints.begin() + begin, mImagePoints.begin() + begin + size);
+    mPointIds.erase(mPointIds.begin() + begin, mPointIds.begin() + begin + size);
+    mViewSizes.erase(mViewSizes.begin() + index);
+    mViewOffsets.erase(mViewOffsets.begin() + index + 1);
+    for(size_t i = index + 1; i < mViewOffsets.size(); i++)
+        mViewOffsets[i] -= size;
+}
+
+void calib::observationStore::keepViews(const std::vector<size_t>& indices)
+{
+    std::vector<int> viewOffsets(1, 0), viewSizes;
+    viewSizes.reserve(indices.size());
+    size_t pos = 0;
+    for(auto it = indices.begin(); it != indices.end(); ++it) {
+        CV_Assert(*it < mViewSizes.size());
+        int begin = mViewOffsets[*it], size = mViewSizes[*it];
+        // views only move towards the beginning, so the arrays are compacted in place
+        std::copy(mImagePoints.begin() + begin, mImagePoints.begin() + begin + size, mImagePoints.begin() + pos);
+        std::copy(mPointIds.begin() + begin, mPointIds.begin() + begin + size, mPointIds.begin() + pos);
+        pos += size;
+        viewSizes.push_back(size);
+        viewOffsets.push_back((int)pos);
+    }
+    mImagePoints.resize(pos);
+    mPointIds.resize(pos);
+    mViewSizes.swap(viewSizes);
+    mViewOffsets.swap(viewOffsets);
+}
+
+void calib::observationStore::clear()
+{
+    mImagePoints.clear();
+    mPointIds.clear();
+    mViewSizes.clear();
+    mViewOffsets.assign(1, 0);
+}
+
+size_t calib::observationStore::viewsCount() const
+{
+    return mViewSizes.size();
+}
+
+size_t calib::observationStore::pointsCount() const
+{
+    return mImagePoints.size();
+}
+
+cv::Mat calib::observationStore::viewPoints(size_t index) const
+{
+    CV_Assert(index < mViewSizes.size());
+    return cv::Mat(1, mViewSizes[index], CV_32FC2, (void*)(mImagePoints.data() + mViewOffsets[index]));
+}
+
+cv::Mat calib::observationStore::viewIds(size_t index) const
+{
+    CV_Assert(index < mViewSizes.size());
+    return cv::Mat(1, mViewSizes[index], CV_32S, (void*)(mPointIds.data() + mViewOffsets[index]));
+}
+
+cv::Mat calib::observationStore::allPoints() const
+{
+    return mImagePoints.empty() ? cv::Mat() :
+                                  cv::Mat(1, (int)mImagePoints.size(), CV_32FC2, (void*)mImagePoints.data());
+}
+
+cv::Mat calib::observationStore::allIds() const
+{
+    return mPointIds.empty() ? cv::Mat() : cv::Mat(1, (int)mPointIds.size(), CV_32S, (void*)mPointIds.data());
+}
+
+cv::Mat calib::observationStore::viewSizes() const
+{
+    return mViewSizes.empty() ? cv::Mat() : cv::Mat(1, (int)mViewSizes.size(), CV_32S, (void*)mViewSizes.data());
+}
+
+void calib::observationStore::viewObjectPoints(size_t index, std::vector<cv::Point3f>& objectPoints) const
+{
+    CV_Assert(index < mViewSizes.size());
+    objectPoints.resize(mViewSizes[index]);
+    for(int i = 0; i < mViewSizes[index]; i++)
+        objectPoints[i] = mBoardPoints[mPointIds[mViewOffsets[index] + i]];
+}
@@ -1,4 +1,5 @@
 #include "parametersController.hpp"
+#include "linalg.hpp"
 #include <iostream>
 
 template <typename T>
@@ -38,11 +39,33 @@ bool calib::parametersController::loadFromFile(const std::string &inputFileName)
     readFromNode(reader["calibration_step"], mCapParams.calibrationStep);
     readFromNode(reader["max_frames_num"], mCapParams.maxFramesNum);
     readFromNode(reader["min_frames_num"], mCapParams.minFramesNum);
+    readFromNode(reader["candidate_pool_size"], mCapParams.candidatePoolSize);
+    readFromNode(reader["pose_bin_capacity"], mCapParams.poseBinCapacity);
     readFromNode(reader["solver_eps"], mInternalParameters.solverEps);
     readFromNode(reader["solver_max_iters"], mInternalParameters.solverMaxIters);
+    readFromNode(reader["solver_time_budget"], mInternalParameters.solverTimeBudget);
     readFromNode(reader["fast_solver"], mInternalParameters.fastSolving);
+    readFromNode(reader["schur_solver"], mInternalParameters.schurSolving);
+    readFromNode(reader["parallel_solver"], mInternalParameters.parallelSolving);
+    readFromNode(reader["incremental_solver"], mInternalParameters.incrementalSolving);
+    readFromNode(reader["incremental_solver_max_iters"], mInternalParameters.incrementalMaxIters);
+    readFromNode(reader["reuse_factorization"], mInternalParameters.reuseFactorization);
+    readFromNode(reader["dogleg_solver"], mInternalParameters.doglegSolving);
+    readFromNode(reader["mixed_precision_solver"], mInternalParameters.mixedPrecision);
+    readFromNode(reader["broyden_updates"], mInternalParameters.broydenUpdates);
+    readFromNode(reader["division_model_init"], mInternalParameters.divisionModelInit);
+    readFromNode(reader["pcg_solver"], mInternalParameters.pcgSolving);
+    readFromNode(reader["speculative_tuning"], mInternalParameters.speculativeTuning);
+    readFromNode(reader["linalg_backend"], mInternalParameters.linalgBackend);
     readFromNode(reader["frame_filter_conv_param"], mInternalParameters.filterAlpha);
 
+    // the Schur, PCG and dogleg solvers have steps of their own, which don't keep a factorization
+    if(mInternalParameters.reuseFactorization && (mInternalParameters.schurSolving ||
+                                                  mInternalParameters.pcgSolving || mInternalParameters.doglegSolving)) {
+        std::cerr << "Warning: reuse_factorization works with the dense solver only and is ignored" << std::endl;
+        mInternalParameters.reuseFactorization = false;
+    }
+
     bool retValue =
             checkAssertion(mCapParams.charucoDictName >= 0, "Dict name must be >= 0") &&
             checkAssertion(mCapParams.charucoMarkerSize > 0, "Marker size must be positive") &&
@@ -50,8 +73,18 @@ bool calib::parametersController::loadFromFile(const std::string &inputFileName)
             checkAssertion(mCapParams.minFramesNum > 1, "Minimal number of frames for calibration < 1") &&
             checkAssertion(mCapParams.calibrationStep > 0, "Calibration step must be positive") &&
             checkAssertion(mCapParams.maxFramesNum > mCapParams.minFramesNum, "maxFramesNum < minFramesNum") &&
+            checkAssertion(mCapParams.candidatePoolSize == 0 || mCapParams.candidatePoolSize > mCapParams.maxFramesNum,
+                           "Candidate pool size must be 0 or greater than maxFramesNum") &&
+            checkAssertion(mCapParams.poseBinCapacity >= 0, "Pose bin capacity must be non-negative") &&
             checkAssertion(mInternalParameters.solverEps > 0, "Solver precision must be positive") &&
             checkAssertion(mInternalParameters.solverMaxIters > 0, "Max solver iterations number must be positive") &&
+            checkAssertion(mInternalParameters.solverTimeBudget >= 0, "Solver time budget must be non-negative") &&
+            checkAssertion(mInternalParameters.incrementalMaxIters > 0,
+                           "Max incremental solver iterations number must be positive") &&
+            checkAssertion(mInternalParameters.linalgBackend == "default" || mInternalParameters.linalgBackend == "auto" ||
+                           cvfork::isLinalgBackendAvailable(
+                               cvfork::getLinalgBackendByName(mInternalParameters.linalgBackend)),
+                           "Unknown or unavailable linear algebra backend") &&
             checkAssertion(mInternalParameters.filterAlpha >=0 && mInternalParameters.filterAlpha <=1 ,
                            "Frame filter convolution parameter must be in [0,1] interval") &&
             checkAssertion(mCapParams.cameraResolution.width > 0 && mCapParams.cameraResolution.height > 0,
@@ -0,0 +1,166 @@
+#include "pcgSolver.hpp"
+#include "linalg.hpp"
+
+using namespace cv;
+
+static const int NINTRINSIC = CV_CALIB_NINTRINSIC;
+// upper bound of the CG relative residual
+static const double PCG_MAX_FORCING = 0.1;
+static const int PCG_MAX_ITERS = 100;
+
+cvfork::CvLevMarqPCG::CvLevMarqPCG(int _nviews, CvTermCriteria criteria0) :
+    CvLevMarqSchur(_nviews, criteria0), cgIterations(0), firstGradNorm(0)
+{
+    int nparams = NINTRINSIC + nviews*6;
+    intrinsicInv.create(NINTRINSIC, NINTRINSIC, CV_64F);
+    x.create(nparams, 1, CV_64F);
+    r.create(nparams, 1, CV_64F);
+    z.create(nparams, 1, CV_64F);
+    p.create(nparams, 1, CV_64F);
+    q.create(nparams, 1, CV_64F);
+}
+
+cvfork::CvLevMarqPCG::~CvLevMarqPCG()
+{
+}
+
+void cvfork::CvLevMarqPCG::multiplyNormal(double lambda, const double* _x, double* _y) const
+{
+    int nintrinsic = (int)intrinsicIdx.size();
+    const double* U = JtJii.ptr<double>();
+    size_t ustep = JtJii.step1();
+
+    for( int a = 0; a < NINTRINSIC; a++ )
+        _y[a] = 0;
+    for( int a = 0; a < nintrinsic; a++ )
+    {
+        double s = U[a*ustep + a]*lambda*_x[a];
+        for( int b = 0; b < nintrinsic; b++ )
+            s += U[a*ustep + b]*_x[b];
+        _y[a] = s;
+    }
+
+    for( int i = 0; i < nviews; i++ )
+    {
+        const double* W = JtJie.ptr<double>(i*NINTRINSIC);
+        const double* V = JtJee.ptr<double>(i*6);
+        const double* xe = _x + NINTRINSIC + i*6;
+        double* ye = _y + NINTRINSIC + i*6;
+
+        for( int k = 0; k < 6; k++ )
+        {
+            double s = V[k*6 + k]*lambda*xe[k];
+            for( int l = 0; l < 6; l++ )
+                s += V[k*6 + l]*xe[l];
+            for( int a = 0; a < nintrinsic; a++ )
+                s += W[a*6 + k]*_x[a];
+            ye[k] = s;
+        }
+        for( int a = 0; a < nintrinsic; a++ )
+        {
+            double s = 0;
+            for( int l = 0; l < 6; l++ )
+                s += W[a*6 + l]*xe[l];
+            _y[a] += s;
+        }
+    }
+}
+
+void cvfork::CvLevMarqPCG::applyPreconditioner(const double* _r, double* _z) const
+{
+    int nintrinsic = (int)intrinsicIdx.size();
+    const double* Uinv = intrinsicInv.ptr<double>();
+    size_t ustep = intrinsicInv.step1();
+
+    for( int a = 0; a < NINTRINSIC; a++ )
+    {
+        double s = 0;
+        if( a < nintrinsic )
+            for( int b = 0; b < nintrinsic; b++ )
+                s += Uinv[a*ustep + b]*_r[b];
+        _z[a] = s;
+    }
+    for( int i = 0; i < nviews; i++ )
+    {
+        Matx66d Vinv(viewInv.ptr<double>(i*6));
+        Matx<double, 6, 1> ze = Vinv*Matx<double, 6, 1>(_r + NINTRINSIC + i*6);
+        std::copy(ze.val, ze.val + 6, _z + NINTRINSIC + i*6);
+    }
+}
+
+void cvfork::CvLevMarqPCG::step()
+{
+    const double LOG10 = log(10.);
+    double lambda = exp(lambdaLg10*LOG10);
+    int nintrinsic = (int)intrinsicIdx.size();
+    const double* pparam = prevParam->data.db;
+    double* _param = param->data.db;
+
+    // damped diagonal blocks are the preconditioner
+    Mat U(NINTRINSIC, NINTRINSIC, CV_64F), Uinv = intrinsicInv(Rect(0, 0, nintrinsic, nintrinsic));
+    for( int attempt = 0; attempt < 2 && nintrinsic > 0; attempt++ )
+    {
+        JtJii.copyTo(U);
+        for( int a = 0; a < nintrinsic; a++ )
+            U.at<double>(a, a) *= 1. + lambda;
+        Mat Ui = U(Rect(0, 0, nintrinsic, nintrinsic));
+        if( attempt > 0 )
+            cv::invert(Ui, Uinv, DECOMP_SVD);
+        else
+        {
+            setIdentity(Uinv);
+            if( choleskySolve(Ui.ptr<double>(), Ui.step, nintrinsic, Uinv.ptr<double>(), Uinv.step, nintrinsic) )
+                break;
+        }
+    }
+    for( int i = 0; i < nviews; i++ )
+    {
+        Matx66d Vinv;
+        cvfork::invertViewBlock(JtJee.ptr<double>(i*6), 1. + lambda, Vinv);
+        std::copy(Vinv.val, Vinv.val + 36, viewInv.ptr<double>(i*6));
+    }
+
+    int n = x.rows;
+    double *_x = x.ptr<double>(), *_r = r.ptr<double>(), *_z = z.ptr<double>();
+    double *_p = p.ptr<double>(), *_q = q.ptr<double>();
+    cvarrToMat(JtErr).copyTo(r);
+    x = Scalar(0);
+
+    double gradNorm = norm(r);
+    if( firstGradNorm <= 0 )
+        firstGradNorm = gradNorm;
+    double forcing = std::min(PCG_MAX_FORCING, std::sqrt(gradNorm/std::max(firstGradNorm, DBL_MIN)));
+    double tol = forcing*gradNorm;
+
+    applyPreconditioner(_r, _z);
+    z.copyTo(p);
+    double rz = r.dot(z);
+    for( int it = 0; it < std::min(PCG_MAX_ITERS, n); it++ )
+    {
+        multiplyNormal(lambda, _p, _q);
+        double pq = p.dot(q);
+        if( pq <= 0 )
+            break;
+        double alpha = rz/pq;
+        for( int k = 0; k < n; k++ )
+        {
+            _x[k] += alpha*_p[k];
+            _r[k] -= alpha*_q[k];
+        }
+        cgIterations++;
+        if( norm(r) <= tol )
+            break;
+
+        applyPreconditioner(_r, _z);
+        double rzNext = r.dot(z), beta = rzNext/rz;
+        rz = rzNext;
+        for( int k = 0; k < n; k++ )
+            _p[k] = _z[k] + beta*_p[k];
+    }
+
+    std::copy(pparam, pparam + NINTRINSIC, _param);
+    for( int j = 0; j < nintrinsic; j++ )
+        _param[intrinsicIdx[j]] = pparam[intrinsicIdx[j]] - _x[j];
+    for( int k = NINTRINSIC; k < n; k++ )
+        _param[k] = pparam[k] - _x[k];
+}
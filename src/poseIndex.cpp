@@ -0,0 +1,90 @@
+#include "poseIndex.hpp"
+#include "calibCommon.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+
+static int angleBin(double angle)
+{
+    int bin = (int)((angle + calib::maxBoardAngle) * calib::poseIndex::angleBins / (2*calib::maxBoardAngle));
+    return std::min(std::max(bin, 0), calib::poseIndex::angleBins - 1);
+}
+
+calib::poseIndex::poseIndex() :
+    mBinCapacity(0), mBinCounts(binsCount, 0)
+{
+}
+
+void calib::poseIndex::setBinCapacity(int capacity)
+{
+    mBinCapacity = capacity;
+}
+
+int calib::poseIndex::binOf(double pitch, double yaw, const cv::Mat& points, cv::Size imageSize)
+{
+    CV_Assert(points.type() == CV_32FC2 && points.total() > 0 && imageSize.area() > 0);
+
+    // the apparent board size doesn't depend on the intrinsics, unlike the PnP distance
+    std::vector<cv::Point2f> hull;
+    cv::convexHull(points, hull);
+    double scale = std::sqrt(cv::contourArea(hull) / imageSize.area());
+    int scaleBin = scale < 0.25 ? 0 : (scale < 0.5 ? 1 : 2);
+
+    cv::Scalar center = cv::mean(points);
+    int regionX = std::min(std::max((int)(center[0] * regionGridSize / imageSize.width), 0), regionGridSize - 1);
+    int regionY = std::min(std::max((int)(center[1] * regionGridSize / imageSize.height), 0), regionGridSize - 1);
+
+    return ((angleBin(pitch)*angleBins + angleBin(yaw))*scaleBins + scaleBin)*regionGridSize*regionGridSize +
+            regionY*regionGridSize + regionX;
+}
+
+bool calib::poseIndex::isSaturated(int bin) const
+{
+    CV_Assert(bin >= 0 && bin < binsCount);
+    return mBinCapacity > 0 && mBinCounts[bin] >= mBinCapacity;
+}
+
+void calib::poseIndex::addView(int bin)
+{
+    CV_Assert(bin >= 0 && bin < binsCount);
+    mViewBins.push_back(bin);
+    mBinCounts[bin]++;
+}
+
+void calib::poseIndex::removeView(size_t index)
+{
+    CV_Assert(index < mViewBins.size());
+    mBinCounts[mViewBins[index]]--;
+    mViewBins.erase(mViewBins.begin() + index);
+}
+
+void calib::poseIndex::keepViews(const std::vector<size_t>& indices)
+{
+    std::vector<int> viewBins;
+    viewBins.reserve(indices.size());
+    std::fill(mBinCounts.begin(), mBinCounts.end(), 0);
+    for(auto it = indices.begin(); it != indices.end(); ++it) {
+        CV_Assert(*it < mViewBins.size());
+        viewBins.push_back(mViewBins[*it]);
+        mBinCounts[mViewBins[*it]]++;
+    }
+    mViewBins.swap(viewBins);
+}
+
+void calib::poseIndex::clear()
+{
+    mViewBins.clear();
+    std::fill(mBinCounts.begin(), mBinCounts.end(), 0);
+}
+
+size_t calib::poseIndex::viewsCount() const
+{
+    return mViewBins.size();
+}
+
+int calib::poseIndex::viewBin(size_t index) const
+{
+    CV_Assert(index < mViewBins.size());
+    return mViewBins[index];
+}
@@ -0,0 +1,450 @@
+#include "projection.hpp"
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+
+using namespace cv;
+using cvfork::DISTORTION_5;
+using cvfork::DISTORTION_RATIONAL;
+using cvfork::DISTORTION_THIN_PRISM;
+using cvfork::DISTORTION_TILTED;
+
+template<typename T> struct Lanes;
+
+template<> struct Lanes<double>
+{
+    typedef double scalar;
+    enum { nlanes = 1 };
+    static inline double load(const double* ptr) { return *ptr; }
+    static inline void store(double* ptr, double val) { *ptr = val; }
+    static inline double all(double val) { return val; }
+    static inline double inv(double val) { return val ? 1./val : 1.; }
+};
+
+template<> struct Lanes<float>
+{
+    typedef float scalar;
+    enum { nlanes = 1 };
+    static inline float load(const float* ptr) { return *ptr; }
+    static inline void store(float* ptr, float val) { *ptr = val; }
+    static inline float all(double val) { return (float)val; }
+    static inline float inv(float val) { return val ? 1.f/val : 1.f; }
+};
+
+#if CV_SIMD128_64F
+template<> struct Lanes<v_float64x2>
+{
+    typedef double scalar;
+    enum { nlanes = 2 };
+    static inline v_float64x2 load(const double* ptr) { return v_load(ptr); }
+    static inline void store(double* ptr, const v_float64x2& val) { v_store(ptr, val); }
+    static inline v_float64x2 all(double val) { return v_setall_f64(val); }
+    static inline v_float64x2 inv(const v_float64x2& val)
+    {
+        v_float64x2 one = v_setall_f64(1.);
+        return v_select(val == v_setzero_f64(), one, one/val);
+    }
+};
+#endif
+
+#if CV_SIMD128
+template<> struct Lanes<v_float32x4>
+{
+    typedef float scalar;
+    enum { nlanes = 4 };
+    static inline v_float32x4 load(const float* ptr) { return v_load(ptr); }
+    static inline void store(float* ptr, const v_float32x4& val) { v_store(ptr, val); }
+    static inline v_float32x4 all(double val) { return v_setall_f32((float)val); }
+    static inline v_float32x4 inv(const v_float32x4& val)
+    {
+        v_float32x4 one = v_setall_f32(1.f);
+        return v_select(val == v_setzero_f32(), one, one/val);
+    }
+};
+#endif
+
+// the widest lane type available for the storage type
+template<typename S> struct SimdLanes { typedef S type; };
+#if CV_SIMD128_64F
+template<> struct SimdLanes<double> { typedef v_float64x2 type; };
+#endif
+#if CV_SIMD128
+template<> struct SimdLanes<float> { typedef v_float32x4 type; };
+#endif
+
+// points, residuals and Jacobians are stored as S, the view parameters are always double
+template<typename S>
+struct ViewProjection
+{
+    const S *X, *Y, *Z, *u, *v;
+    int n;
+    double R[9], dRdr[27], t[3], k[14];
+    double tilt[9], dTiltdTauX[9], dTiltdTauY[9];
+    double fx, fy, cx, cy, aspectRatio;
+    S *err, *JeT, *JiT;
+    size_t jeStep, jiStep;
+    const int* rows;
+};
+
+// see computeTiltProjectionMatrix() in OpenCV
+static void computeTiltMatrix(double tauX, double tauY, Matx33d& matTilt, Matx33d& dMatTiltdTauX,
+                              Matx33d& dMatTiltdTauY)
+{
+    double cTauX = std::cos(tauX), sTauX = std::sin(tauX);
+    double cTauY = std::cos(tauY), sTauY = std::sin(tauY);
+    Matx33d matRotX(1, 0, 0, 0, cTauX, sTauX, 0, -sTauX, cTauX);
+    Matx33d matRotY(cTauY, 0, -sTauY, 0, 1, 0, sTauY, 0, cTauY);
+    Matx33d matRotXY = matRotY*matRotX;
+    Matx33d matProjZ(matRotXY(2, 2), 0, -matRotXY(0, 2), 0, matRotXY(2, 2), -matRotXY(1, 2), 0, 0, 1);
+    matTilt = matProjZ*matRotXY;
+
+    Matx33d dMatRotXYdTauX = matRotY*Matx33d(0, 0, 0, 0, -sTauX, cTauX, 0, -cTauX, -sTauX);
+    Matx33d dMatProjZdTauX(dMatRotXYdTauX(2, 2), 0, -dMatRotXYdTauX(0, 2),
+                           0, dMatRotXYdTauX(2, 2), -dMatRotXYdTauX(1, 2), 0, 0, 0);
+    dMatTiltdTauX = matProjZ*dMatRotXYdTauX + dMatProjZdTauX*matRotXY;
+
+    Matx33d dMatRotXYdTauY = Matx33d(-sTauY, 0, -cTauY, 0, 0, 0, cTauY, 0, -sTauY)*matRotX;
+    Matx33d dMatProjZdTauY(dMatRotXYdTauY(2, 2), 0, -dMatRotXYdTauY(0, 2),
+                           0, dMatRotXYdTauY(2, 2), -dMatRotXYdTauY(1, 2), 0, 0, 0);
+    dMatTiltdTauY = matProjZ*dMatRotXYdTauY + dMatProjZdTauY*matRotXY;
+}
+
+// Projects nlanes points at once, the math follows cvProjectPoints2. Terms of the distortion model
+// which are absent in Model and derivatives of fixed aspect ratio / principal point are compiled out.
+// Both the SIMD and the scalar (tail and fallback) paths are instantiated from this code.
+template<typename T, int Model, bool FixAspect, bool FixPP>
+class ProjectLanes
+{
+public:
+    typedef Lanes<T> L;
+    typedef typename L::scalar S;
+
+    ProjectLanes(const ViewProjection<S>& _p) : p(_p)
+    {
+        for( int j = 0; j < 9; j++ )
+            R[j] = L::all(p.R[j]);
+        for( int j = 0; j < 27; j++ )
+            dRdr[j] = L::all(p.dRdr[j]);
+        for( int j = 0; j < 3; j++ )
+            t[j] = L::all(p.t[j]);
+        for( int j = 0; j < 14; j++ )
+            k[j] = L::all(p.k[j]);
+        for( int j = 0; j < 9; j++ )
+        {
+            tilt[j] = L::all(p.tilt[j]);
+            dTiltdTauX[j] = L::all(p.dTiltdTauX[j]);
+            dTiltdTauY[j] = L::all(p.dTiltdTauY[j]);
+        }
+        fx = L::all(p.fx); fy = L::all(p.fy);
+        cx = L::all(p.cx); cy = L::all(p.cy);
+        aspectRatio = L::all(p.aspectRatio);
+        zero = L::all(0.); one = L::all(1.); two = L::all(2.);
+        three = L::all(3.); four = L::all(4.);
+    }
+
+    void operator()(int i) const
+    {
+        const int n = p.n;
+        T X = L::load(p.X + i), Y = L::load(p.Y + i), Z = L::load(p.Z + i);
+        T x = R[0]*X + R[1]*Y + R[2]*Z + t[0];
+        T y = R[3]*X + R[4]*Y + R[5]*Z + t[1];
+        T z = L::inv(R[6]*X + R[7]*Y + R[8]*Z + t[2]);
+        x = x*z; y = y*z;
+
+        T r2 = x*x + y*y, r4 = r2*r2, r6 = r4*r2;
+        T a1 = two*x*y, a2 = r2 + two*x*x, a3 = r2 + two*y*y;
+        T cdist = one + k[0]*r2 + k[1]*r4 + k[4]*r6;
+        T icdist2 = Model >= DISTORTION_RATIONAL ? one/(one + k[5]*r2 + k[6]*r4 + k[7]*r6) : one;
+        T xd0 = x*cdist*icdist2 + k[2]*a1 + k[3]*a2;
+        T yd0 = y*cdist*icdist2 + k[2]*a3 + k[3]*a1;
+        if( Model >= DISTORTION_THIN_PRISM )
+        {
+            xd0 = xd0 + k[8]*r2 + k[9]*r4;
+            yd0 = yd0 + k[10]*r2 + k[11]*r4;
+        }
+
+        // projection onto the tilted sensor plane, dM is its derivative by (xd0, yd0)
+        T xd = xd0, yd = yd0, invProj2 = one;
+        T vt[3] = { zero, zero, one }, dM[4] = { one, zero, zero, one };
+        if( Model == DISTORTION_TILTED )
+        {
+            for( int j = 0; j < 3; j++ )
+                vt[j] = tilt[j*3]*xd0 + tilt[j*3 + 1]*yd0 + tilt[j*3 + 2];
+            T invProj = L::inv(vt[2]);
+            xd = invProj*vt[0]; yd = invProj*vt[1];
+            invProj2 = invProj*invProj;
+            for( int r = 0; r < 2; r++ )
+                for( int c = 0; c < 2; c++ )
+                    dM[r*2 + c] = (tilt[r*3 + c]*vt[2] - tilt[6 + c]*vt[r])*invProj2;
+        }
+
+        L::store(p.err + i, xd*fx + cx - L::load(p.u + i));
+        L::store(p.err + n + i, yd*fy + cy - L::load(p.v + i));
+        if( !p.JeT )
+            return;
+
+        S* Ji = p.JiT + i;
+        const int* rows = p.rows;
+
+        // focal length and principal point
+        if( FixAspect )
+        {
+            storeRow(Ji, rows[0], zero, zero);
+            storeRow(Ji, rows[1], xd*aspectRatio, yd);
+        }
+        else
+        {
+            storeRow(Ji, rows[0], xd, zero);
+            storeRow(Ji, rows[1], zero, yd);
+        }
+        if( !FixPP )
+        {
+            storeRow(Ji, rows[2], one, zero);
+            storeRow(Ji, rows[3], zero, one);
+        }
+
+        // distortion coefficients
+        T xr = x*icdist2, yr = y*icdist2;
+        storeDerivative(Ji, rows[4], xr*r2, yr*r2, dM);
+        storeDerivative(Ji, rows[5], xr*r4, yr*r4, dM);
+        storeDerivative(Ji, rows[6], a1, a3, dM);
+        storeDerivative(Ji, rows[7], a2, a1, dM);
+        storeDerivative(Ji, rows[8], xr*r6, yr*r6, dM);
+        if( Model >= DISTORTION_RATIONAL )
+        {
+            T xq = zero - xr*cdist*icdist2, yq = zero - yr*cdist*icdist2;
+            storeDerivative(Ji, rows[9], xq*r2, yq*r2, dM);
+            storeDerivative(Ji, rows[10], xq*r4, yq*r4, dM);
+            storeDerivative(Ji, rows[11], xq*r6, yq*r6, dM);
+        }
+        if( Model >= DISTORTION_THIN_PRISM )
+        {
+            storeDerivative(Ji, rows[12], r2, zero, dM);
+            storeDerivative(Ji, rows[13], r4, zero, dM);
+            storeDerivative(Ji, rows[14], zero, r2, dM);
+            storeDerivative(Ji, rows[15], zero, r4, dM);
+        }
+        if( Model == DISTORTION_TILTED )
+        {
+            storeTiltDerivative(Ji, rows[16], dTiltdTauX, xd0, yd0, vt, invProj2);
+            storeTiltDerivative(Ji, rows[17], dTiltdTauY, xd0, yd0, vt, invProj2);
+        }
+
+        // extrinsics
+        T cs = cdist*icdist2;
+        T g = (k[0] + two*k[1]*r2 + three*k[4]*r4)*icdist2;
+        if( Model >= DISTORTION_RATIONAL )
+            g = g - cs*icdist2*(k[5] + two*k[6]*r2 + three*k[7]*r4);
+        T sx = zero, sy = zero;
+        if( Model >= DISTORTION_THIN_PRISM )
+        {
+            sx = k[8] + two*r2*k[9];
+            sy = k[10] + two*r2*k[11];
+        }
+        S* Je = p.JeT + i;
+
+        for( int j = 0; j < 3; j++ )
+        {
+            const T* dR = dRdr + j*9;
+            T dx0 = X*dR[0] + Y*dR[1] + Z*dR[2];
+            T dy0 = X*dR[3] + Y*dR[4] + Z*dR[5];
+            T dz0 = X*dR[6] + Y*dR[7] + Z*dR[8];
+            T dmx, dmy;
+            distortionDerivative(x, y, z*(dx0 - x*dz0), z*(dy0 - y*dz0), cs, g, sx, sy, dmx, dmy);
+            storeExtrinsic(Je, j, dmx, dmy, dM);
+        }
+
+        T dmx, dmy;
+        distortionDerivative(x, y, z, zero, cs, g, sx, sy, dmx, dmy);
+        storeExtrinsic(Je, 3, dmx, dmy, dM);
+        distortionDerivative(x, y, zero, z, cs, g, sx, sy, dmx, dmy);
+        storeExtrinsic(Je, 4, dmx, dmy, dM);
+        distortionDerivative(x, y, zero - x*z, zero - y*z, cs, g, sx, sy, dmx, dmy);
+        storeExtrinsic(Je, 5, dmx, dmy, dM);
+    }
+
+private:
+    inline void storeRow(S* Ji, int row, const T& dx, const T& dy) const
+    {
+        if( row >= 0 )
+        {
+            L::store(Ji + p.jiStep*row, dx);
+            L::store(Ji + p.jiStep*row + p.n, dy);
+        }
+    }
+
+    // derivative of the distorted point, taken through the tilt projection and scaled by focal lengths
+    inline void tiltDerivative(const T& dx, const T& dy, const T* dM, T& ox, T& oy) const
+    {
+        if( Model == DISTORTION_TILTED )
+        {
+            ox = fx*(dM[0]*dx + dM[1]*dy);
+            oy = fy*(dM[2]*dx + dM[3]*dy);
+        }
+        else
+        {
+            ox = fx*dx;
+            oy = fy*dy;
+        }
+    }
+
+    inline void storeDerivative(S* Ji, int row, const T& dx, const T& dy, const T* dM) const
+    {
+        if( row >= 0 )
+        {
+            T ox, oy;
+            tiltDerivative(dx, dy, dM, ox, oy);
+            storeRow(Ji, row, ox, oy);
+        }
+    }
+
+    inline void storeExtrinsic(S* Je, int row, const T& dx, const T& dy, const T* dM) const
+    {
+        T ox, oy;
+        tiltDerivative(dx, dy, dM, ox, oy);
+        L::store(Je + p.jeStep*row, ox);
+        L::store(Je + p.jeStep*row + p.n, oy);
+    }
+
+    inline void storeTiltDerivative(S* Ji, int row, const T* dTilt, const T& xd0, const T& yd0,
+                                    const T* vt, const T& invProj2) const
+    {
+        if( row >= 0 )
+        {
+            T dvt[3];
+            for( int j = 0; j < 3; j++ )
+                dvt[j] = dTilt[j*3]*xd0 + dTilt[j*3 + 1]*yd0 + dTilt[j*3 + 2];
+            storeRow(Ji, row, fx*invProj2*(dvt[0]*vt[2] - dvt[2]*vt[0]),
+                     fy*invProj2*(dvt[1]*vt[2] - dvt[2]*vt[1]));
+        }
+    }
+
+    // derivative of the distorted point by a change (dx, dy) of the normalized one
+    inline void distortionDerivative(const T& x, const T& y, const T& dx, const T& dy, const T& cs,
+                                     const T& g, const T& sx, const T& sy, T& dmx, T& dmy) const
+    {
+        T dr2 = two*(x*dx + y*dy);
+        T da1 = two*(x*dy + y*dx);
+        dmx = dx*cs + (x*g + sx)*dr2 + k[2]*da1 + k[3]*(dr2 + four*x*dx);
+        dmy = dy*cs + (y*g + sy)*dr2 + k[2]*(dr2 + four*y*dy) + k[3]*da1;
+    }
+
+    const ViewProjection<S>& p;
+    T R[9], dRdr[27], t[3], k[14];
+    T tilt[9], dTiltdTauX[9], dTiltdTauY[9];
+    T fx, fy, cx, cy, aspectRatio;
+    T zero, one, two, three, four;
+};
+
+template<typename T, int Model, bool FixAspect, bool FixPP>
+static int projectBatch(const ViewProjection<typename Lanes<T>::scalar>& p, int start)
+{
+    ProjectLanes<T, Model, FixAspect, FixPP> project(p);
+    int i = start;
+    for( ; i + Lanes<T>::nlanes <= p.n; i += Lanes<T>::nlanes )
+        project(i);
+    return i;
+}
+
+template<typename S, int Model, bool FixAspect, bool FixPP>
+static void projectViewPoints(const S* objX, const S* objY, const S* objZ,
+                              const S* imgX, const S* imgY, int npoints,
+                              const double* rvec, const double* tvec, const Matx33d& cameraMatrix,
+                              const double* distCoeffs, double aspectRatio, S* err,
+                              S* JeT, size_t jeStep, S* JiT, size_t jiStep, const int* intrinsicRows)
+{
+    ViewProjection<S> p;
+    p.X = objX; p.Y = objY; p.Z = objZ;
+    p.u = imgX; p.v = imgY;
+    p.n = npoints;
+
+    Matx33d R;
+    Matx<double, 3, 9> dRdr;
+    Rodrigues(Matx31d(rvec), R, dRdr);
+    std::copy(R.val, R.val + 9, p.R);
+    std::copy(dRdr.val, dRdr.val + 27, p.dRdr);
+    std::copy(tvec, tvec + 3, p.t);
+    std::copy(distCoeffs, distCoeffs + 14, p.k);
+
+    if( Model == DISTORTION_TILTED )
+    {
+        Matx33d tilt, dTiltdTauX, dTiltdTauY;
+        computeTiltMatrix(p.k[12], p.k[13], tilt, dTiltdTauX, dTiltdTauY);
+        std::copy(tilt.val, tilt.val + 9, p.tilt);
+        std::copy(dTiltdTauX.val, dTiltdTauX.val + 9, p.dTiltdTauX);
+        std::copy(dTiltdTauY.val, dTiltdTauY.val + 9, p.dTiltdTauY);
+    }
+    else
+    {
+        std::fill(p.tilt, p.tilt + 9, 0.);
+        std::fill(p.dTiltdTauX, p.dTiltdTauX + 9, 0.);
+        std::fill(p.dTiltdTauY, p.dTiltdTauY + 9, 0.);
+    }
+
+    p.fy = cameraMatrix(1, 1);
+    p.fx = FixAspect ? p.fy*aspectRatio : cameraMatrix(0, 0);
+    p.cx = cameraMatrix(0, 2);
+    p.cy = cameraMatrix(1, 2);
+    p.aspectRatio = aspectRatio;
+
+    p.err = err;
+    p.JeT = JeT; p.jeStep = jeStep;
+    p.JiT = JiT; p.jiStep = jiStep;
+    p.rows = intrinsicRows;
+
+    int i = projectBatch<typename SimdLanes<S>::type, Model, FixAspect, FixPP>(p, 0);
+    projectBatch<S, Model, FixAspect, FixPP>(p, i);
+}
+
+template<typename S, int Model>
+static typename cvfork::ProjectViewPoints<S>::Func getModelFunc(bool fixAspect, bool fixPP)
+{
+    if( fixAspect )
+        return fixPP ? projectViewPoints<S, Model, true, true> : projectViewPoints<S, Model, true, false>;
+    return fixPP ? projectViewPoints<S, Model, false, true> : projectViewPoints<S, Model, false, false>;
+}
+
+template<typename S>
+static typename cvfork::ProjectViewPoints<S>::Func getFunc(int distortionModel, int flags)
+{
+    bool fixAspect = (flags & CALIB_FIX_ASPECT_RATIO) != 0;
+    bool fixPP = (flags & CALIB_FIX_PRINCIPAL_POINT) != 0;
+
+    switch( distortionModel )
+    {
+    case DISTORTION_5:
+        return getModelFunc<S, DISTORTION_5>(fixAspect, fixPP);
+    case DISTORTION_RATIONAL:
+        return getModelFunc<S, DISTORTION_RATIONAL>(fixAspect, fixPP);
+    case DISTORTION_THIN_PRISM:
+        return getModelFunc<S, DISTORTION_THIN_PRISM>(fixAspect, fixPP);
+    case DISTORTION_TILTED:
+        return getModelFunc<S, DISTORTION_TILTED>(fixAspect, fixPP);
+    default:
+        CV_Error( CV_StsBadArg, "Unknown distortion model" );
+    }
+    return 0;
+}
+
+int cvfork::selectDistortionModel(int flags, const double* distCoeffs, int ndistCoeffs)
+{
+    double k[14] = {0};
+    std::copy(distCoeffs, distCoeffs + std::min(ndistCoeffs, 14), k);
+
+    if( (flags & CALIB_TILTED_MODEL) || k[12] != 0 || k[13] != 0 )
+        return DISTORTION_TILTED;
+    if( (flags & CALIB_THIN_PRISM_MODEL) || k[8] != 0 || k[9] != 0 || k[10] != 0 || k[11] != 0 )
+        return DISTORTION_THIN_PRISM;
+    if( (flags & CALIB_RATIONAL_MODEL) || k[5] != 0 || k[6] != 0 || k[7] != 0 )
+        return DISTORTION_RATIONAL;
+    return DISTORTION_5;
+}
+
+cvfork::ProjectViewPointsFunc cvfork::getProjectViewPointsFunc(int distortionModel, int flags)
+{
+    return getFunc<double>(distortionModel, flags);
+}
+
+cvfork::ProjectViewPointsFunc32f cvfork::getProjectViewPointsFunc32f(int distortionModel, int flags)
+{
+    return getFunc<float>(distortionModel, flags);
+}
@@ -0,0 +1,120 @@
+#include "blockKernels.hpp"
+
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+
+// Heap allocations and time per view of the normal equations accumulation: the MatExpr products the
+// calibration used before and the fixed-size block kernels which replaced them. Allocations are
+// counted by wrapping the glibc allocator, elsewhere only the times are printed.
+static const int NINTRINSIC = 18;
+// points of a 9x6 chessboard view
+static const int POINTS_NUM = 54;
+static const int ITERATIONS = 20000;
+
+static std::atomic<long> allocations(0);
+
+#ifdef __GLIBC__
+#define COUNT_ALLOCATIONS 1
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+
+void* malloc(size_t size) __THROW
+{
+    allocations++;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) __THROW
+{
+    allocations++;
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) __THROW
+{
+    allocations++;
+    return __libc_realloc(ptr, size);
+}
+
+// cv::fastMalloc uses it for the Mat data
+int posix_memalign(void** ptr, size_t alignment, size_t size) __THROW
+{
+    allocations++;
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr ? 0 : ENOMEM;
+}
+}
+#else
+#define COUNT_ALLOCATIONS 0
+#endif
+
+struct Measurement
+{
+    long allocations;
+    double microseconds;
+};
+
+template<typename Accumulate>
+static Measurement measure(Accumulate accumulate)
+{
+    // the first run may set up buffers which are kept between the calls
+    accumulate();
+    long start = allocations;
+    int64 ticks = cv::getTickCount();
+    for(int i = 0; i < ITERATIONS; i++)
+        accumulate();
+    Measurement m;
+    m.microseconds = (cv::getTickCount() - ticks)*1e6/cv::getTickFrequency()/ITERATIONS;
+    m.allocations = allocations - start;
+    return m;
+}
+
+int main()
+{
+    const int N = NINTRINSIC, len = POINTS_NUM*2;
+    cv::RNG rng(0x12345);
+    cv::Mat Ji(len, N, CV_64F), Je(len, 6, CV_64F), err(len, 1, CV_64F);
+    rng.fill(Ji, cv::RNG::UNIFORM, -1, 1);
+    rng.fill(Je, cv::RNG::UNIFORM, -1, 1);
+    rng.fill(err, cv::RNG::UNIFORM, -1, 1);
+    // the kernels take the Jacobians transposed, one row per parameter
+    cv::Mat JiT = Ji.t(), JeT = Je.t();
+    cv::Mat JtJ(N + 6, N + 6, CV_64F, cv::Scalar(0)), JtErr(N + 6, 1, CV_64F, cv::Scalar(0));
+    cv::Mat viewJtJ(N, N, CV_64F), viewJtErr(N, 1, CV_64F);
+
+    Measurement products = measure([&]() {
+        JtJ(cv::Rect(0, 0, N, N)) += Ji.t()*Ji;
+        JtJ(cv::Rect(N, N, 6, 6)) = Je.t()*Je;
+        JtJ(cv::Rect(N, 0, 6, N)) = Ji.t()*Je;
+        JtErr.rowRange(0, N) += Ji.t()*err;
+        JtErr.rowRange(N, N + 6) = Je.t()*err;
+    });
+
+    // the same blocks as in CalibrateViewsInvoker::calibrateViews
+    Measurement kernels = measure([&]() {
+        const double *ji = JiT.ptr<double>(), *je = JeT.ptr<double>(), *e = err.ptr<double>();
+        cv::Mat V = JtJ(cv::Rect(N, N, 6, 6)), W = JtJ(cv::Rect(N, 0, 6, N)), ee = JtErr.rowRange(N, N + 6);
+        cvfork::multiplyTransposedSelf(ji, JiT.step1(), N, len, viewJtJ.ptr<double>(), viewJtJ.step1());
+        cvfork::multiplyTransposedSelf(je, JeT.step1(), 6, len, V.ptr<double>(), V.step1());
+        cvfork::multiplyTransposedExtrinsic(ji, JiT.step1(), N, je, JeT.step1(), len, W.ptr<double>(), W.step1());
+        cvfork::multiplyVector(ji, JiT.step1(), N, e, len, viewJtErr.ptr<double>(), viewJtErr.step1());
+        cvfork::multiplyVector(je, JeT.step1(), 6, e, len, ee.ptr<double>(), ee.step1());
+    });
+
+    std::cout << "view of " << POINTS_NUM << " points, " << N << " intrinsics" << std::endl;
+    const char* names[] = { "MatExpr products", "block kernels" };
+    const Measurement* results[] = { &products, &kernels };
+    for(int j = 0; j < 2; j++) {
+        std::cout << names[j] << ": " << results[j]->microseconds << " us";
+        if(COUNT_ALLOCATIONS)
+            std::cout << ", " << (double)results[j]->allocations/ITERATIONS << " allocations";
+        std::cout << " per view" << std::endl;
+    }
+    return COUNT_ALLOCATIONS && kernels.allocations != 0 ? 1 : 0;
+}
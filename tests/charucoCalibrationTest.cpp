@@ -0,0 +1,80 @@
+#include "cvCalibrationFork.hpp"
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/aruco/charuco.hpp>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// calibrateCameraCharuco gathers the views by point ids instead of copying the object points,
+// the solver gets the same data as from calibrateCamera, so only the summation order may differ
+static const double MAX_INTRINSIC_REL_DIFF = 1e-9;
+static const double MAX_DISTORTION_ABS_DIFF = 1e-9;
+static const int VIEWS_NUM = 12;
+static const double NOISE_SIGMA = 0.1;
+// share of the corners detected in a view, the rest are missing as if occluded
+static const double DETECTED_SHARE = 0.8;
+
+int main()
+{
+    cv::Ptr<cv::aruco::CharucoBoard> board = cv::aruco::CharucoBoard::create(7, 5, 0.03f, 0.02f,
+        cv::aruco::getPredefinedDictionary(cv::aruco::DICT_4X4_50));
+    const std::vector<cv::Point3f>& model = board->chessboardCorners;
+
+    cv::Size imageSize(640, 480);
+    cv::Mat cameraMatrix = (cv::Mat_<double>(3, 3) << 800, 0, 320, 0, 790, 240, 0, 0, 1);
+    cv::Mat distCoeffs = (cv::Mat_<double>(1, 5) << -0.2, 0.05, 0.001, -0.0005, 0);
+
+    // charuco views are kept as detected: std::vector<Point2f> corners, i.e. Nx1 arrays, with their ids
+    std::vector<std::vector<cv::Point2f> > charucoCorners;
+    std::vector<std::vector<int> > charucoIds;
+    std::vector<std::vector<cv::Point3f> > objectPoints;
+    cv::RNG rng(0x12345);
+    for(int v = 0; v < VIEWS_NUM; v++) {
+        cv::Vec3d rvec(rng.uniform(-0.5, 0.5), rng.uniform(-0.5, 0.5), rng.uniform(-0.3, 0.3));
+        cv::Vec3d tvec(rng.uniform(-0.12, -0.06), rng.uniform(-0.09, -0.03), rng.uniform(0.4, 0.7));
+        std::vector<cv::Point2f> projected;
+        cv::projectPoints(model, rvec, tvec, cameraMatrix, distCoeffs, projected);
+
+        std::vector<cv::Point2f> corners;
+        std::vector<int> ids;
+        std::vector<cv::Point3f> viewObjectPoints;
+        for(size_t k = 0; k < projected.size(); k++) {
+            if(rng.uniform(0., 1.) > DETECTED_SHARE)
+                continue;
+            corners.push_back(projected[k] + cv::Point2f((float)rng.gaussian(NOISE_SIGMA),
+                                                         (float)rng.gaussian(NOISE_SIGMA)));
+            ids.push_back((int)k);
+            viewObjectPoints.push_back(model[k]);
+        }
+        charucoCorners.push_back(corners);
+        charucoIds.push_back(ids);
+        objectPoints.push_back(viewObjectPoints);
+    }
+
+    cv::Mat A[2], k[2];
+    double rms[2];
+    rms[0] = cvfork::calibrateCamera(objectPoints, charucoCorners, imageSize, A[0], k[0], cv::noArray(),
+                                     cv::noArray(), cv::noArray(), cv::noArray());
+    rms[1] = cvfork::calibrateCameraCharuco(charucoCorners, charucoIds, board, imageSize, A[1], k[1],
+                                            cv::noArray(), cv::noArray(), cv::noArray(), cv::noArray());
+
+    bool passed = std::abs(rms[1] - rms[0]) <= MAX_INTRINSIC_REL_DIFF*rms[0];
+    std::cout << "RMS: object points " << rms[0] << ", charuco " << rms[1] << std::endl;
+    const char* names[] = { "fx", "fy", "cx", "cy" };
+    const int rows[] = { 0, 1, 0, 1 }, cols[] = { 0, 1, 2, 2 };
+    for(int p = 0; p < 4; p++) {
+        double ref = A[0].at<double>(rows[p], cols[p]), val = A[1].at<double>(rows[p], cols[p]);
+        std::cout << names[p] << ": object points " << ref << ", charuco " << val << std::endl;
+        passed &= std::abs(val - ref) <= MAX_INTRINSIC_REL_DIFF*std::abs(ref);
+    }
+    for(int p = 0; p < 5; p++) {
+        double ref = k[0].at<double>(p), val = k[1].at<double>(p);
+        std::cout << "k[" << p << "]: object points " << ref << ", charuco " << val << std::endl;
+        passed &= std::abs(val - ref) <= MAX_DISTORTION_ABS_DIFF;
+    }
+    passed &= rms[1] < 3*NOISE_SIGMA && std::abs(A[1].at<double>(0, 0) - 800) < 8;
+
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
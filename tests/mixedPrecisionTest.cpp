@@ -0,0 +1,82 @@
+#include "cvCalibrationFork.hpp"
+
+#include <opencv2/calib3d.hpp>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// Mixed precision calibration finishes with double kernels and terminates on double residuals,
+// so its result has to match the double precision one up to the solver tolerance, far below
+// the noise of the board corners. These are the tolerances CALIB_USE_MIXED_PRECISION promises
+static const double MAX_INTRINSIC_REL_DIFF = 1e-6;
+static const double MAX_DISTORTION_ABS_DIFF = 1e-6;
+static const double MAX_RMS_REL_DIFF = 1e-6;
+// the synthetic board views
+static const int VIEWS_NUM = 15;
+static const double NOISE_SIGMA = 0.1;
+
+static void generateViews(std::vector<std::vector<cv::Point3f> >& objectPoints,
+                          std::vector<std::vector<cv::Point2f> >& imagePoints,
+                          const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs)
+{
+    std::vector<cv::Point3f> board;
+    for(int i = 0; i < 6; i++)
+        for(int j = 0; j < 9; j++)
+            board.push_back(cv::Point3f(j*0.025f, i*0.025f, 0));
+
+    cv::RNG rng(0x12345);
+    for(int v = 0; v < VIEWS_NUM; v++) {
+        // tilts up to ~30 degrees, the board center stays close to the optical axis
+        cv::Vec3d rvec(rng.uniform(-0.5, 0.5), rng.uniform(-0.5, 0.5), rng.uniform(-0.3, 0.3));
+        cv::Vec3d tvec(rng.uniform(-0.15, -0.05), rng.uniform(-0.11, -0.01), rng.uniform(0.4, 0.7));
+        std::vector<cv::Point2f> projected;
+        cv::projectPoints(board, rvec, tvec, cameraMatrix, distCoeffs, projected);
+        for(size_t k = 0; k < projected.size(); k++) {
+            projected[k].x += (float)rng.gaussian(NOISE_SIGMA);
+            projected[k].y += (float)rng.gaussian(NOISE_SIGMA);
+        }
+        objectPoints.push_back(board);
+        imagePoints.push_back(projected);
+    }
+}
+
+int main()
+{
+    cv::Size imageSize(640, 480);
+    cv::Mat cameraMatrix = (cv::Mat_<double>(3, 3) << 800, 0, 320, 0, 790, 240, 0, 0, 1);
+    cv::Mat distCoeffs = (cv::Mat_<double>(1, 5) << -0.2, 0.05, 0.001, -0.0005, 0);
+
+    std::vector<std::vector<cv::Point3f> > objectPoints;
+    std::vector<std::vector<cv::Point2f> > imagePoints;
+    generateViews(objectPoints, imagePoints, cameraMatrix, distCoeffs);
+
+    // both runs stop on convergence rather than on the iterations count
+    cv::TermCriteria criteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 100, DBL_EPSILON);
+    cv::Mat A[2], k[2];
+    double rms[2];
+    for(int i = 0; i < 2; i++) {
+        int flags = i ? CALIB_USE_MIXED_PRECISION : 0;
+        rms[i] = cvfork::calibrateCamera(objectPoints, imagePoints, imageSize, A[i], k[i], cv::noArray(),
+                                         cv::noArray(), cv::noArray(), cv::noArray(), flags, criteria);
+    }
+
+    bool passed = std::abs(rms[1] - rms[0]) <= MAX_RMS_REL_DIFF*rms[0];
+    std::cout << "RMS: double " << rms[0] << ", mixed " << rms[1] << std::endl;
+    const char* names[] = { "fx", "fy", "cx", "cy" };
+    const int rows[] = { 0, 1, 0, 1 }, cols[] = { 0, 1, 2, 2 };
+    for(int p = 0; p < 4; p++) {
+        double ref = A[0].at<double>(rows[p], cols[p]), val = A[1].at<double>(rows[p], cols[p]);
+        std::cout << names[p] << ": double " << ref << ", mixed " << val << std::endl;
+        passed &= std::abs(val - ref) <= MAX_INTRINSIC_REL_DIFF*std::abs(ref);
+    }
+    for(int p = 0; p < 5; p++) {
+        double ref = k[0].at<double>(p), val = k[1].at<double>(p);
+        std::cout << "k[" << p << "]: double " << ref << ", mixed " << val << std::endl;
+        passed &= std::abs(val - ref) <= MAX_DISTORTION_ABS_DIFF;
+    }
+    // the double precision result itself must be a sane calibration of the synthetic camera
+    passed &= rms[0] < 3*NOISE_SIGMA && std::abs(A[0].at<double>(0, 0) - 800) < 8;
+
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
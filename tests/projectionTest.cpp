@@ -0,0 +1,136 @@
+#include "projection.hpp"
+
+#include <opencv2/calib3d.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+// projectViewPoints follows the math of cvProjectPoints2 term by term, only the evaluation order
+// differs, so both the projections and the Jacobians have to agree up to rounding
+static const double MAX_REL_DIFF = 1e-12;
+// odd, so that both the SIMD batches and the scalar tail of the kernel are covered
+static const int POINTS_NUM = 37;
+static const int NINTRINSIC = 18;
+
+// largest difference of the rows of a and b, relative to the largest value of the row of b
+static double maxRowDiff(const cv::Mat& a, const cv::Mat& b)
+{
+    double maxDiff = 0;
+    for(int r = 0; r < b.rows; r++) {
+        double scale = std::max(cv::norm(b.row(r), cv::NORM_INF), 1.);
+        maxDiff = std::max(maxDiff, cv::norm(a.row(r), b.row(r), cv::NORM_INF) / scale);
+    }
+    return maxDiff;
+}
+
+// cvProjectPoints2 Jacobians are 2N x k with interleaved x, y rows, the kernel stores them transposed
+// as k rows of [x derivatives, y derivatives]
+static cv::Mat transposeJacobian(const cv::Mat& J)
+{
+    cv::Mat JT(J.cols, J.rows, CV_64F);
+    int n = J.rows/2;
+    for(int c = 0; c < J.cols; c++)
+        for(int i = 0; i < n; i++) {
+            JT.at<double>(c, i) = J.at<double>(2*i, c);
+            JT.at<double>(c, n + i) = J.at<double>(2*i + 1, c);
+        }
+    return JT;
+}
+
+static bool checkProjection(int model, int ndistCoeffs, bool fixAspect, bool fixPP)
+{
+    cv::RNG rng(0x12345 + model);
+    std::vector<double> objX(POINTS_NUM), objY(POINTS_NUM), objZ(POINTS_NUM);
+    cv::Mat objectPoints(POINTS_NUM, 1, CV_64FC3);
+    for(int i = 0; i < POINTS_NUM; i++) {
+        // a non-planar cloud, so that no Jacobian column degenerates
+        objX[i] = rng.uniform(-0.15, 0.15);
+        objY[i] = rng.uniform(-0.1, 0.1);
+        objZ[i] = rng.uniform(-0.05, 0.05);
+        objectPoints.at<cv::Vec3d>(i) = cv::Vec3d(objX[i], objY[i], objZ[i]);
+    }
+    double rvec[3] = { 0.3, -0.2, 0.1 }, tvec[3] = { 0.02, -0.01, 0.5 };
+    cv::Matx33d cameraMatrix(800, 0, 320, 0, 790, 240, 0, 0, 1);
+    double aspectRatio = fixAspect ? 1.01 : 0;
+    double k[14] = { -0.2, 0.05, 0.001, -0.0005, 0.01, 0.002, -0.001, 0.0005,
+                     0.001, -0.0005, 0.0008, 0.0002, 0.01, -0.02 };
+    std::fill(k + ndistCoeffs, k + 14, 0.);
+
+    // reference projection and Jacobians
+    cv::Mat rvecM(3, 1, CV_64F, rvec), tvecM(3, 1, CV_64F, tvec), A(cameraMatrix), distM(1, ndistCoeffs, CV_64F, k);
+    cv::Mat projected(POINTS_NUM, 1, CV_64FC2);
+    cv::Mat dpdr(2*POINTS_NUM, 3, CV_64F), dpdt(2*POINTS_NUM, 3, CV_64F), dpdf(2*POINTS_NUM, 2, CV_64F),
+            dpdc(2*POINTS_NUM, 2, CV_64F), dpdk(2*POINTS_NUM, ndistCoeffs, CV_64F);
+    CvMat c_objectPoints = objectPoints, c_rvec = rvecM, c_tvec = tvecM, c_A = A, c_dist = distM;
+    CvMat c_projected = projected, c_dpdr = dpdr, c_dpdt = dpdt, c_dpdf = dpdf, c_dpdc = dpdc, c_dpdk = dpdk;
+    cvProjectPoints2(&c_objectPoints, &c_rvec, &c_tvec, &c_A, &c_dist, &c_projected,
+                     &c_dpdr, &c_dpdt, &c_dpdf, &c_dpdc, &c_dpdk, aspectRatio);
+
+    // the observations are the reference projections with noise, residuals are compared as projections
+    std::vector<double> imgX(POINTS_NUM), imgY(POINTS_NUM);
+    for(int i = 0; i < POINTS_NUM; i++) {
+        imgX[i] = projected.at<cv::Vec2d>(i)[0] + rng.gaussian(0.5);
+        imgY[i] = projected.at<cv::Vec2d>(i)[1] + rng.gaussian(0.5);
+    }
+
+    int flags = (fixAspect ? cv::CALIB_FIX_ASPECT_RATIO : 0) | (fixPP ? cv::CALIB_FIX_PRINCIPAL_POINT : 0);
+    cvfork::ProjectViewPointsFunc project = cvfork::getProjectViewPointsFunc(model, flags);
+    int intrinsicRows[NINTRINSIC];
+    for(int j = 0; j < NINTRINSIC; j++)
+        intrinsicRows[j] = j;
+    if(fixPP)
+        intrinsicRows[2] = intrinsicRows[3] = -1;
+    // rows the kernel must not touch keep NaN
+    cv::Mat err(2*POINTS_NUM, 1, CV_64F), JeT(6, 2*POINTS_NUM, CV_64F),
+            JiT(NINTRINSIC, 2*POINTS_NUM, CV_64F, cv::Scalar(std::numeric_limits<double>::quiet_NaN()));
+    project(&objX[0], &objY[0], &objZ[0], &imgX[0], &imgY[0], POINTS_NUM, rvec, tvec, cameraMatrix, k,
+            aspectRatio, err.ptr<double>(), JeT.ptr<double>(), JeT.step1(), JiT.ptr<double>(), JiT.step1(),
+            intrinsicRows);
+
+    cv::Mat projectedT(2, POINTS_NUM, CV_64F), refT(2, POINTS_NUM, CV_64F);
+    for(int i = 0; i < POINTS_NUM; i++) {
+        projectedT.at<double>(0, i) = err.at<double>(i) + imgX[i];
+        projectedT.at<double>(1, i) = err.at<double>(POINTS_NUM + i) + imgY[i];
+        refT.at<double>(0, i) = projected.at<cv::Vec2d>(i)[0];
+        refT.at<double>(1, i) = projected.at<cv::Vec2d>(i)[1];
+    }
+
+    double diffs[] = {
+        maxRowDiff(projectedT, refT),
+        maxRowDiff(JeT.rowRange(0, 3), transposeJacobian(dpdr)),
+        maxRowDiff(JeT.rowRange(3, 6), transposeJacobian(dpdt)),
+        maxRowDiff(JiT.rowRange(0, 2), transposeJacobian(dpdf)),
+        fixPP ? 0. : maxRowDiff(JiT.rowRange(2, 4), transposeJacobian(dpdc)),
+        maxRowDiff(JiT.rowRange(4, 4 + ndistCoeffs), transposeJacobian(dpdk))
+    };
+    const char* names[] = { "projections", "dpdr", "dpdt", "dpdf", "dpdc", "dpdk" };
+
+    bool passed = true;
+    std::cout << "model " << model << " (" << ndistCoeffs << " coefficients)"
+              << (fixAspect ? ", fixed aspect" : "") << (fixPP ? ", fixed principal point" : "") << ":";
+    for(int j = 0; j < 6; j++) {
+        std::cout << " " << names[j] << " " << diffs[j];
+        passed &= diffs[j] <= MAX_REL_DIFF;
+    }
+    if(fixPP)
+        passed &= std::isnan(JiT.at<double>(2, 0)) && std::isnan(JiT.at<double>(3, 2*POINTS_NUM - 1));
+    std::cout << (passed ? "" : " FAILED") << std::endl;
+    return passed;
+}
+
+int main()
+{
+    const int models[] = { cvfork::DISTORTION_5, cvfork::DISTORTION_RATIONAL,
+                           cvfork::DISTORTION_THIN_PRISM, cvfork::DISTORTION_TILTED };
+    const int ndistCoeffs[] = { 5, 8, 12, 14 };
+
+    bool passed = true;
+    for(int m = 0; m < 4; m++)
+        for(int variant = 0; variant < 4; variant++)
+            passed &= checkProjection(models[m], ndistCoeffs[m], (variant & 1) != 0, (variant & 2) != 0);
+
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}